@@ -0,0 +1,306 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_ANIMATION_SEQUENCER_HPP_
+#define SSD1306_ANIMATION_SEQUENCER_HPP_
+
+#include "ssd1306.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace embdrv
+{
+/// What an animation does after a step
+enum class animation_action : uint8_t
+{
+	/// Step again as soon as the frame has been uploaded
+	nextFrame = 0,
+	/// Step again once the frame has been uploaded and the delay has elapsed
+	delay,
+	/// The animation is complete and is removed from the sequencer
+	finished,
+};
+
+/// The result of an animation step
+struct animation_result
+{
+	animation_action action;
+	/// The delay in milliseconds, measured from the start of the step
+	uint32_t delay_ms;
+
+	/// Resume once the frame is on the panel
+	static constexpr animation_result nextFrame() noexcept
+	{
+		return {animation_action::nextFrame, 0};
+	}
+
+	/// Resume once the frame is on the panel and `ms` milliseconds have elapsed since the step
+	static constexpr animation_result delay(uint32_t ms) noexcept
+	{
+		return {animation_action::delay, ms};
+	}
+
+	/// Remove the animation once this step has been drawn
+	static constexpr animation_result finished() noexcept
+	{
+		return {animation_action::finished, 0};
+	}
+};
+
+/** An animation which is stepped by an animation_sequencer
+ *
+ * Animations are resumable state machines: each step() draws the next frame (or part of one)
+ * into the screen buffer and returns, keeping its progress in member variables, instead of
+ * looping over blocking display() calls.
+ */
+class animation
+{
+  public:
+	virtual ~animation() = default;
+
+	/// Draw the next step of the animation
+	/// @param display The display to draw on. Do not call display() from a step.
+	/// @param now_ms The current time in milliseconds.
+	/// @returns when the animation should be stepped again.
+	virtual animation_result step(ssd1306& display, uint32_t now_ms) noexcept = 0;
+};
+
+/** Steps concurrent animations on one display without blocking
+ *
+ * Each tick() steps every animation which is due, then uploads the frame once for all of them:
+ * the changes made by all animations stepped in the same tick are merged into a single upload
+ * by the display's dirty tracking. Animations resume only after the upload has completed, so a
+ * step never draws into a frame which is still being sent. Enable chunked uploads on the
+ * display to send only the columns the animations changed.
+ *
+ * Upload completion is reported from the I2C completion context, but animations are only
+ * stepped from tick(), which must be called from thread context. An optional callback is
+ * invoked on completion, e.g. to wake the thread which calls tick().
+ *
+ * The sequencer issues the display's uploads itself, so the display should not also use a
+ * frame rate limit or be registered with an ssd1306_manager. Other code may still call
+ * display() or wake() while a sequencer frame is in flight: the sequencer resumes once its
+ * frame, or the upload which superseded it, has reached the panel. displayViewport() must not
+ * be called while busy() returns true.
+ *
+ * @tparam TMaxAnimations The maximum number of concurrent animations.
+ */
+template<size_t TMaxAnimations = 8>
+class animation_sequencer
+{
+  public:
+	/// Upload completion callback
+	/// @param ctx The context pointer supplied with the callback.
+	using notify_fn_t = void (*)(void* ctx);
+
+	/// Create an animation sequencer
+	/// @param display The display which the animations draw on.
+	explicit animation_sequencer(ssd1306& display) noexcept : display_(display) {}
+
+	/// Add an animation. Its first step happens on the next tick().
+	/// @param a The animation to run. It must remain valid until it finishes or is stopped.
+	/// @returns false if the sequencer is full.
+	bool start(animation& a) noexcept
+	{
+		for(auto& s : slots_)
+		{
+			if(s.anim == nullptr)
+			{
+				s.anim = &a;
+				s.due = true;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// Remove an animation. Its last drawn step stays on the screen.
+	void stop(animation& a) noexcept
+	{
+		for(auto& s : slots_)
+		{
+			if(s.anim == &a)
+			{
+				s.anim = nullptr;
+			}
+		}
+	}
+
+	/// Check whether an animation is running
+	bool running(const animation& a) const noexcept
+	{
+		for(const auto& s : slots_)
+		{
+			if(s.anim == &a)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// @returns the number of running animations
+	size_t active() const noexcept
+	{
+		size_t n = 0;
+		for(const auto& s : slots_)
+		{
+			n += (s.anim != nullptr) ? 1 : 0;
+		}
+
+		return n;
+	}
+
+	/// Check whether a frame upload is in progress
+	bool busy() const noexcept
+	{
+		return busy_.load();
+	}
+
+	/// Set a callback which is invoked from the completion context when a frame upload completes
+	/// @param notify The callback, or nullptr to disable notification.
+	/// @param ctx Context pointer passed to the callback.
+	void onFrameComplete(notify_fn_t notify, void* ctx = nullptr) noexcept
+	{
+		notify_ = notify;
+		notify_ctx_ = ctx;
+	}
+
+	/** Step the animations which are due and upload the result
+	 *
+	 * This does nothing while a frame upload is in progress, or while the display is asleep:
+	 * animations are paused until wake().
+	 *
+	 * @param now_ms The current time in milliseconds.
+	 */
+	void tick(uint32_t now_ms) noexcept
+	{
+		if(busy_.load() || display_.asleep())
+		{
+			return;
+		}
+
+		bool stepped = false;
+
+		for(auto& s : slots_)
+		{
+			if(s.anim == nullptr || !isDue(s, now_ms))
+			{
+				continue;
+			}
+
+			const auto result = s.anim->step(display_, now_ms);
+			stepped = true;
+
+			switch(result.action)
+			{
+				case animation_action::nextFrame:
+					s.due = true;
+					break;
+				case animation_action::delay:
+					s.due = false;
+					s.wake_ms = now_ms + result.delay_ms;
+					break;
+				case animation_action::finished:
+					s.anim = nullptr;
+					break;
+			}
+		}
+
+		if(!stepped)
+		{
+			return;
+		}
+
+		frames_++;
+		busy_ = true;
+		display_.uploadFrame([this](auto op, auto status) {
+			(void)op;
+			if(status != embvm::i2c::status::ok)
+			{
+				errors_++;
+			}
+
+			busy_ = false;
+
+			if(notify_)
+			{
+				notify_(notify_ctx_);
+			}
+		});
+	}
+
+	/// Get the time until the next animation is due
+	/// @param now_ms The current time in milliseconds.
+	/// @returns 0 if an animation is due (or a frame upload is in progress), the number of
+	///	milliseconds until the next delayed animation is due, or UINT32_MAX if no animations are
+	///	running.
+	uint32_t msUntilNext(uint32_t now_ms) const noexcept
+	{
+		uint32_t next = UINT32_MAX;
+
+		for(const auto& s : slots_)
+		{
+			if(s.anim == nullptr)
+			{
+				continue;
+			}
+
+			if(isDue(s, now_ms) || busy_.load())
+			{
+				return 0;
+			}
+
+			next = std::min(next, s.wake_ms - now_ms);
+		}
+
+		return next;
+	}
+
+	/// @returns the number of frames uploaded by the sequencer
+	uint32_t frames() const noexcept
+	{
+		return frames_;
+	}
+
+	/// @returns the number of frame uploads which reported an error
+	uint32_t errors() const noexcept
+	{
+		return errors_;
+	}
+
+  private:
+	struct slot
+	{
+		animation* anim = nullptr;
+		/// Step on the next tick, regardless of wake_ms
+		bool due = false;
+		uint32_t wake_ms = 0;
+	};
+
+	static bool isDue(const slot& s, uint32_t now_ms) noexcept
+	{
+		// Signed difference handles wraparound of the millisecond counter
+		return s.due || static_cast<int32_t>(now_ms - s.wake_ms) >= 0;
+	}
+
+	ssd1306& display_;
+	std::array<slot, TMaxAnimations> slots_{};
+
+	/// Indicates that a frame upload is in progress. Cleared from the completion context.
+	std::atomic<bool> busy_{false};
+
+	notify_fn_t notify_ = nullptr;
+	void* notify_ctx_ = nullptr;
+
+	uint32_t frames_ = 0;
+	std::atomic<uint32_t> errors_{0};
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_ANIMATION_SEQUENCER_HPP_
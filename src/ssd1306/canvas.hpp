@@ -0,0 +1,149 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_CANVAS_HPP_
+#define SSD1306_CANVAS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace embdrv
+{
+/// A pixel coordinate
+struct point
+{
+	uint8_t x;
+	uint8_t y;
+};
+
+/// Pack a pixel coordinate into 16 bits, with x in the upper byte and y in the lower byte
+constexpr uint16_t packPoint(uint8_t x, uint8_t y) noexcept
+{
+	return static_cast<uint16_t>((x << 8) | y);
+}
+
+/** A monochrome pixel buffer in the SSD1306 GDRAM layout
+ *
+ * The buffer is organized in pages: each byte holds a vertical strip of 8 pixels (LSB on top),
+ * and each page is `width` bytes long. This matches the controller's memory layout, so rows of
+ * a page can be streamed to the display without conversion.
+ *
+ * This class does not own its storage. Use static_canvas to declare a canvas with storage.
+ */
+class canvas
+{
+  public:
+	/// The number of pixel rows stored in each byte
+	static constexpr uint8_t PAGE_HEIGHT = 8;
+
+	/// Create a canvas backed by an existing buffer
+	/// @param buffer The pixel storage, at least (width * height / 8) bytes.
+	/// @param width The width of the canvas in pixels.
+	/// @param height The height of the canvas in pixels. Must be a multiple of 8.
+	canvas(uint8_t* buffer, uint16_t width, uint16_t height) noexcept
+		: buffer_(buffer), width_(width), height_(height)
+	{
+	}
+
+	/// @returns the width of the canvas in pixels
+	uint16_t width() const noexcept
+	{
+		return width_;
+	}
+
+	/// @returns the height of the canvas in pixels
+	uint16_t height() const noexcept
+	{
+		return height_;
+	}
+
+	/// @returns the number of pages in the canvas
+	uint16_t pages() const noexcept
+	{
+		return height_ / PAGE_HEIGHT;
+	}
+
+	/// @returns the size of the canvas storage in bytes
+	size_t size() const noexcept
+	{
+		return static_cast<size_t>(width_) * pages();
+	}
+
+	/// @returns a pointer to the canvas storage
+	uint8_t* buffer() noexcept
+	{
+		return buffer_;
+	}
+
+	/// @returns a pointer to the canvas storage
+	const uint8_t* buffer() const noexcept
+	{
+		return buffer_;
+	}
+
+	/// Get a pointer to the first byte of a page
+	/// @param page The page index.
+	/// @param column The column offset within the page.
+	uint8_t* page(uint16_t page, uint16_t column = 0) noexcept
+	{
+		return &buffer_[(page * width_) + column];
+	}
+
+	/// Get a pointer to the first byte of a page
+	/// @param page The page index.
+	/// @param column The column offset within the page.
+	const uint8_t* page(uint16_t page, uint16_t column = 0) const noexcept
+	{
+		return &buffer_[(page * width_) + column];
+	}
+
+	/// Set all bytes of the canvas to a value
+	/// @param value The value to fill the canvas with.
+	void fill(uint8_t value) noexcept
+	{
+		memset(buffer_, value, size());
+	}
+
+	~canvas() = default;
+	canvas(const canvas&) = delete;
+	canvas& operator=(const canvas&) = delete;
+	canvas(canvas&&) = delete;
+	canvas& operator=(canvas&&) = delete;
+
+  private:
+	uint8_t* const buffer_;
+	const uint16_t width_;
+	const uint16_t height_;
+};
+
+/** A canvas with statically allocated storage
+ *
+ * Drawing coordinates are limited to the range of basicDisplay::coord_t, so each dimension is
+ * limited to 256 pixels.
+ *
+ * @tparam TWidth The width of the canvas in pixels.
+ * @tparam THeight The height of the canvas in pixels. Must be a multiple of 8.
+ */
+template<uint16_t TWidth, uint16_t THeight>
+class static_canvas final : public canvas
+{
+	static_assert(THeight % canvas::PAGE_HEIGHT == 0, "Canvas height must be a multiple of 8");
+	static_assert(TWidth <= 256 && THeight <= 256, "Canvas dimensions must fit in coord_t");
+
+  public:
+	static_canvas() noexcept : canvas(storage_, TWidth, THeight) {}
+	~static_canvas() = default;
+
+	static_canvas(const static_canvas&) = delete;
+	static_canvas& operator=(const static_canvas&) = delete;
+	static_canvas(static_canvas&&) = delete;
+	static_canvas& operator=(static_canvas&&) = delete;
+
+  private:
+	uint8_t storage_[(TWidth * THeight) / canvas::PAGE_HEIGHT] = {0};
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_CANVAS_HPP_
@@ -0,0 +1,208 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#include "frame_mirror.hpp"
+#include <cassert>
+#include <cstring>
+
+using namespace embdrv;
+
+namespace
+{
+constexpr uint8_t SYNC_0 = UINT8_C(0xA5);
+constexpr uint8_t SYNC_1 = UINT8_C(0x5A);
+constexpr uint8_t KEYFRAME = 'K';
+constexpr uint8_t DELTA = 'D';
+constexpr uint8_t END_OF_FRAME = UINT8_C(0xFF);
+
+constexpr uint8_t REPEAT_PACKET = UINT8_C(0x80);
+constexpr uint16_t MAX_PACKET = 128;
+/// Shorter repeats are cheaper to send as part of a literal packet
+constexpr uint16_t MIN_REPEAT = 3;
+
+/// Unchanged columns between two changed runs are sent anyway if that is cheaper than starting
+/// a new record (page, column, and count bytes)
+constexpr uint16_t MAX_MERGE_GAP = 3;
+
+constexpr uint16_t FLETCHER_MODULUS = 255;
+
+/// @returns the number of times data[0] repeats, up to the packet limit
+uint16_t repeatLength(const uint8_t* data, uint16_t remaining) noexcept
+{
+	const auto limit = remaining < MAX_PACKET ? remaining : MAX_PACKET;
+	uint16_t n = 1;
+	while(n < limit && data[n] == data[0])
+	{
+		n++;
+	}
+
+	return n;
+}
+
+} // namespace
+
+void frame_mirror::update(const canvas& frame) noexcept
+{
+	assert(frame.width() == shadow_.width() && frame.height() == shadow_.height());
+
+	const bool keyframe =
+		keyframe_requested_ ||
+		(keyframe_interval_ != 0 && frames_since_keyframe_ >= keyframe_interval_);
+
+	const auto width = frame.width();
+	bool started = false;
+
+	if(keyframe)
+	{
+		beginFrame(true, frame);
+		started = true;
+	}
+
+	for(uint16_t page = 0; page < frame.pages(); page++)
+	{
+		const auto* current = frame.page(page);
+		auto* previous = shadow_.page(page);
+
+		if(keyframe)
+		{
+			encodeRun(static_cast<uint8_t>(page), 0, width, current);
+			continue;
+		}
+
+		if(memcmp(current, previous, width) == 0)
+		{
+			continue;
+		}
+
+		uint16_t column = 0;
+		while(column < width)
+		{
+			if(current[column] == previous[column])
+			{
+				column++;
+				continue;
+			}
+
+			// Extend the run across short unchanged gaps
+			const auto first = column;
+			auto last = column;
+			for(column++; column < width && (column - last) <= MAX_MERGE_GAP; column++)
+			{
+				if(current[column] != previous[column])
+				{
+					last = column;
+				}
+			}
+
+			if(!started)
+			{
+				beginFrame(false, frame);
+				started = true;
+			}
+
+			encodeRun(static_cast<uint8_t>(page), first, static_cast<uint16_t>(last - first + 1),
+					  &current[first]);
+			column = static_cast<uint16_t>(last + 1);
+		}
+	}
+
+	if(!started)
+	{
+		return;
+	}
+
+	endFrame();
+	memcpy(shadow_.buffer(), frame.buffer(), frame.size());
+}
+
+void frame_mirror::beginFrame(bool keyframe, const canvas& frame) noexcept
+{
+	if(keyframe)
+	{
+		keyframe_requested_ = false;
+		frames_since_keyframe_ = 0;
+	}
+
+	frames_since_keyframe_++;
+
+	putUnchecked(SYNC_0);
+	putUnchecked(SYNC_1);
+
+	sum1_ = 0;
+	sum2_ = 0;
+	put(keyframe ? KEYFRAME : DELTA);
+	put(sequence_++);
+	put(static_cast<uint8_t>(frame.width() - 1));
+	put(static_cast<uint8_t>(frame.pages()));
+}
+
+void frame_mirror::endFrame() noexcept
+{
+	put(END_OF_FRAME);
+
+	const auto sum1 = static_cast<uint8_t>(sum1_);
+	const auto sum2 = static_cast<uint8_t>(sum2_);
+	putUnchecked(sum1);
+	putUnchecked(sum2);
+	flush();
+}
+
+void frame_mirror::encodeRun(uint8_t page, uint16_t column, uint16_t count,
+							 const uint8_t* data) noexcept
+{
+	put(page);
+	put(static_cast<uint8_t>(column));
+	put(static_cast<uint8_t>(count - 1));
+
+	uint16_t i = 0;
+	while(i < count)
+	{
+		const auto repeat = repeatLength(&data[i], static_cast<uint16_t>(count - i));
+		if(repeat >= MIN_REPEAT)
+		{
+			put(static_cast<uint8_t>(REPEAT_PACKET | (repeat - 1)));
+			put(data[i]);
+			i = static_cast<uint16_t>(i + repeat);
+			continue;
+		}
+
+		// Collect literals until the next worthwhile repeat
+		const auto start = i;
+		while(i < count && (i - start) < MAX_PACKET &&
+			  repeatLength(&data[i], static_cast<uint16_t>(count - i)) < MIN_REPEAT)
+		{
+			i++;
+		}
+
+		put(static_cast<uint8_t>(i - start - 1));
+		for(auto j = start; j < i; j++)
+		{
+			put(data[j]);
+		}
+	}
+}
+
+void frame_mirror::put(uint8_t b) noexcept
+{
+	sum1_ = static_cast<uint16_t>((sum1_ + b) % FLETCHER_MODULUS);
+	sum2_ = static_cast<uint16_t>((sum2_ + sum1_) % FLETCHER_MODULUS);
+	putUnchecked(b);
+}
+
+void frame_mirror::putUnchecked(uint8_t b) noexcept
+{
+	staging_[staged_++] = b;
+	if(staged_ == STAGING_SIZE)
+	{
+		flush();
+	}
+}
+
+void frame_mirror::flush() noexcept
+{
+	if(staged_ != 0)
+	{
+		sink_(staging_, staged_, ctx_);
+		staged_ = 0;
+	}
+}
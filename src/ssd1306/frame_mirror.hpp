@@ -0,0 +1,134 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_FRAME_MIRROR_HPP_
+#define SSD1306_FRAME_MIRROR_HPP_
+
+#include "canvas.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace embdrv
+{
+/** Encodes displayed frames into a compact stream for remote viewing
+ *
+ * Each call to update() compares the frame with a shadow copy of the last mirrored frame and
+ * emits only the changed column runs of each page. A keyframe containing every page is emitted
+ * for the first frame, periodically, and on request, so a viewer that joins late or loses data
+ * can resynchronize. Unchanged frames emit nothing.
+ *
+ * Stream format (decoded by tools/mirror_decode.py):
+ *
+ *     frame:  0xA5 0x5A type seq width-1 pages record* 0xFF sum1 sum2
+ *     type:   'K' (keyframe, every page is sent) or 'D' (delta against the previous frame)
+ *     seq:    frame sequence number, incremented for each emitted frame (modulo 256)
+ *     record: page column count-1 packet*      (count bytes of page data, starting at column)
+ *     packet: 0x00-0x7F: (n + 1) literal bytes follow
+ *             0x80-0xFF: the next byte is repeated ((n & 0x7F) + 1) times
+ *     sum:    Fletcher-16 checksum of everything from `type` through the 0xFF end marker
+ *
+ * Page data uses the canvas layout: one byte per column, LSB on top.
+ *
+ * When attached to a display with ssd1306::mirror(), only frames uploaded by display() are
+ * mirrored. Viewport and column stream output is not.
+ *
+ * This class does not own the shadow frame. Use static_frame_mirror to declare a mirror with
+ * storage.
+ */
+class frame_mirror
+{
+  public:
+	/// Receives encoded stream bytes
+	/// @param data The encoded bytes.
+	/// @param size The number of encoded bytes.
+	/// @param ctx The context pointer supplied with the sink.
+	using sink_fn_t = void (*)(const uint8_t* data, size_t size, void* ctx);
+
+	/// Create a frame mirror
+	/// @param shadow Storage for the last mirrored frame. Its size must match the frames passed
+	///	to update().
+	/// @param sink The function which receives the encoded stream.
+	/// @param ctx Context pointer passed to the sink.
+	/// @param keyframe_interval The number of emitted frames between keyframes. 0 only sends a
+	///	keyframe for the first frame and on request.
+	frame_mirror(canvas& shadow, sink_fn_t sink, void* ctx,
+				 uint8_t keyframe_interval = 64) noexcept
+		: shadow_(shadow), sink_(sink), ctx_(ctx), keyframe_interval_(keyframe_interval)
+	{
+	}
+
+	/// Encode the changes in a frame and pass them to the sink
+	/// This is cheap when little has changed: unchanged pages are skipped with a single compare.
+	void update(const canvas& frame) noexcept;
+
+	/// Send a keyframe with the next update(), e.g. when a viewer connects
+	void requestKeyframe() noexcept
+	{
+		keyframe_requested_ = true;
+	}
+
+	/// Set the number of emitted frames between keyframes
+	void keyframeInterval(uint8_t interval) noexcept
+	{
+		keyframe_interval_ = interval;
+	}
+
+	~frame_mirror() = default;
+	frame_mirror(const frame_mirror&) = delete;
+	frame_mirror& operator=(const frame_mirror&) = delete;
+	frame_mirror(frame_mirror&&) = delete;
+	frame_mirror& operator=(frame_mirror&&) = delete;
+
+  private:
+	/// The number of bytes staged before they are passed to the sink
+	static constexpr size_t STAGING_SIZE = 32;
+
+	void beginFrame(bool keyframe, const canvas& frame) noexcept;
+	void endFrame() noexcept;
+	void encodeRun(uint8_t page, uint16_t column, uint16_t count, const uint8_t* data) noexcept;
+	void put(uint8_t b) noexcept;
+	void putUnchecked(uint8_t b) noexcept;
+	void flush() noexcept;
+
+	canvas& shadow_;
+	const sink_fn_t sink_;
+	void* const ctx_;
+	uint8_t keyframe_interval_;
+	uint8_t frames_since_keyframe_ = 0;
+	uint8_t sequence_ = 0;
+	bool keyframe_requested_ = true;
+
+	uint8_t staging_[STAGING_SIZE] = {0};
+	size_t staged_ = 0;
+	uint16_t sum1_ = 0;
+	uint16_t sum2_ = 0;
+};
+
+/** A frame mirror with statically allocated shadow storage
+ *
+ * @tparam TWidth The width of the mirrored frames in pixels.
+ * @tparam THeight The height of the mirrored frames in pixels. Must be a multiple of 8.
+ */
+template<uint16_t TWidth, uint16_t THeight>
+class static_frame_mirror final : public frame_mirror
+{
+  public:
+	static_frame_mirror(sink_fn_t sink, void* ctx, uint8_t keyframe_interval = 64) noexcept
+		: frame_mirror(shadow_, sink, ctx, keyframe_interval)
+	{
+	}
+
+	~static_frame_mirror() = default;
+
+	static_frame_mirror(const static_frame_mirror&) = delete;
+	static_frame_mirror& operator=(const static_frame_mirror&) = delete;
+	static_frame_mirror(static_frame_mirror&&) = delete;
+	static_frame_mirror& operator=(static_frame_mirror&&) = delete;
+
+  private:
+	static_canvas<TWidth, THeight> shadow_;
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_FRAME_MIRROR_HPP_
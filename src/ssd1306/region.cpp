@@ -0,0 +1,358 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#include "region.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace embdrv;
+
+namespace
+{
+using word_t = uint32_t;
+
+constexpr int16_t LANES = sizeof(word_t);
+constexpr word_t LANE_ONES = UINT32_C(0x01010101);
+constexpr int16_t PAGE_HEIGHT = canvas::PAGE_HEIGHT;
+
+/// A clipped rectangle, in pixels
+struct bounds
+{
+	int16_t x;
+	int16_t y;
+	int16_t width;
+	int16_t height;
+};
+
+/// Clip a rectangle to the canvas
+/// @returns false if nothing of the rectangle is left.
+bool clip(const canvas& c, bounds& r) noexcept
+{
+	if(r.x < 0)
+	{
+		r.width += r.x;
+		r.x = 0;
+	}
+
+	if(r.y < 0)
+	{
+		r.height += r.y;
+		r.y = 0;
+	}
+
+	r.width = static_cast<int16_t>(std::min<int>(r.width, c.width() - r.x));
+	r.height = static_cast<int16_t>(std::min<int>(r.height, c.height() - r.y));
+
+	return r.width > 0 && r.height > 0;
+}
+
+/// @returns a mask of the rows of a page that are in [first, last)
+uint8_t rowMask(int16_t page, int16_t first, int16_t last) noexcept
+{
+	const auto lo = std::max<int>(first - (page * PAGE_HEIGHT), 0);
+	const auto hi = std::min<int>(last - (page * PAGE_HEIGHT), PAGE_HEIGHT);
+
+	if(lo >= hi)
+	{
+		return 0;
+	}
+
+	return static_cast<uint8_t>((0xFFU >> (PAGE_HEIGHT - (hi - lo))) << lo);
+}
+
+/// Replicate a byte into each lane of a word
+constexpr word_t lanes(uint8_t b) noexcept
+{
+	return LANE_ONES * b;
+}
+
+word_t load(const uint8_t* p) noexcept
+{
+	word_t w = 0;
+	memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+void store(uint8_t* p, word_t w) noexcept
+{
+	memcpy(p, &w, sizeof(w));
+}
+
+/// Shift each byte lane of a word towards the MSB (down the screen), dropping carried bits
+constexpr word_t laneShiftDown(word_t w, uint8_t shift) noexcept
+{
+	return (w << shift) & lanes(static_cast<uint8_t>(0xFFU << shift));
+}
+
+/// Shift each byte lane of a word towards the LSB (up the screen), dropping carried bits
+constexpr word_t laneShiftUp(word_t w, uint8_t shift) noexcept
+{
+	return (w >> shift) & lanes(static_cast<uint8_t>(0xFFU >> shift));
+}
+
+/// Apply an operation to the rows of a rectangle
+/// @param op Invoked with the current word and the lane-replicated row mask of the page.
+template<typename TOp>
+void forEachWord(canvas& c, const bounds& r, const TOp& op) noexcept
+{
+	const auto first_page = static_cast<int16_t>(r.y / PAGE_HEIGHT);
+	const auto last_page = static_cast<int16_t>((r.y + r.height - 1) / PAGE_HEIGHT);
+
+	for(auto page = first_page; page <= last_page; page++)
+	{
+		const auto mask = rowMask(page, r.y, static_cast<int16_t>(r.y + r.height));
+		auto* p = c.page(static_cast<uint16_t>(page), static_cast<uint16_t>(r.x));
+		int16_t col = 0;
+
+		for(; col + LANES <= r.width; col += LANES)
+		{
+			store(&p[col], op(load(&p[col]), lanes(mask)));
+		}
+
+		for(; col < r.width; col++)
+		{
+			p[col] = static_cast<uint8_t>(op(p[col], mask));
+		}
+	}
+}
+
+} // namespace
+
+void region::invert(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height) noexcept
+{
+	bounds r{x, y, width, height};
+	if(!clip(c, r))
+	{
+		return;
+	}
+
+	forEachWord(c, r, [](word_t w, word_t mask) { return w ^ mask; });
+}
+
+void region::fill(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height,
+				  bool set) noexcept
+{
+	bounds r{x, y, width, height};
+	if(!clip(c, r))
+	{
+		return;
+	}
+
+	if(set)
+	{
+		forEachWord(c, r, [](word_t w, word_t mask) { return w | mask; });
+	}
+	else
+	{
+		forEachWord(c, r, [](word_t w, word_t mask) { return w & ~mask; });
+	}
+}
+
+void region::copy(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, int16_t dst_x,
+				  int16_t dst_y) noexcept
+{
+	const auto dx = static_cast<int16_t>(dst_x - x);
+	const auto dy = static_cast<int16_t>(dst_y - y);
+
+	// Clip the source, then the destination, then map the result back to the source
+	bounds src{x, y, width, height};
+	if(!clip(c, src))
+	{
+		return;
+	}
+
+	bounds dst{static_cast<int16_t>(src.x + dx), static_cast<int16_t>(src.y + dy), src.width,
+			   src.height};
+	if(!clip(c, dst))
+	{
+		return;
+	}
+
+	// Destination row r comes from source row (r - dy). Split the offset into whole pages and
+	// a bit shift, rounding towards negative infinity so the shift is always positive.
+	const auto page_offset = static_cast<int16_t>(
+		(dy >= 0) ? (dy / PAGE_HEIGHT) : -((PAGE_HEIGHT - 1 - dy) / PAGE_HEIGHT));
+	const auto shift = static_cast<uint8_t>(dy - (page_offset * PAGE_HEIGHT));
+
+	const auto first_page = static_cast<int16_t>(dst.y / PAGE_HEIGHT);
+	const auto last_page = static_cast<int16_t>((dst.y + dst.height - 1) / PAGE_HEIGHT);
+	const auto pages = static_cast<int16_t>(c.pages());
+	const auto dst_bottom = static_cast<int16_t>(dst.y + dst.height);
+
+	// Walk against the direction of the move, so overlapping source data is read before it
+	// is overwritten
+	const int16_t page_step = (dy > 0) ? -1 : 1;
+	const bool right_to_left = dx > 0;
+	const auto full_words = static_cast<int16_t>(dst.width / LANES);
+	const auto tail = static_cast<int16_t>(dst.width % LANES);
+
+	auto page = (page_step < 0) ? last_page : first_page;
+	for(; page >= first_page && page <= last_page; page += page_step)
+	{
+		const auto mask = rowMask(page, dst.y, dst_bottom);
+		const auto src_page = static_cast<int16_t>(page - page_offset);
+		const bool has_src = src_page >= 0 && src_page < pages;
+		const bool has_carry = shift != 0 && (src_page - 1) >= 0 && (src_page - 1) < pages;
+
+		uint8_t* d = c.page(static_cast<uint16_t>(page), static_cast<uint16_t>(dst.x));
+		const uint8_t* s =
+			has_src ? c.page(static_cast<uint16_t>(src_page), static_cast<uint16_t>(dst.x - dx))
+					: nullptr;
+		const uint8_t* carry =
+			has_carry
+				? c.page(static_cast<uint16_t>(src_page - 1), static_cast<uint16_t>(dst.x - dx))
+				: nullptr;
+
+		const auto value = [&](word_t source, word_t carried) {
+			auto v = laneShiftDown(source, shift);
+			if(shift != 0)
+			{
+				v |= laneShiftUp(carried, static_cast<uint8_t>(PAGE_HEIGHT - shift));
+			}
+			return v;
+		};
+
+		const auto copyWord = [&](int16_t col) {
+			const auto v = value(s ? load(&s[col]) : 0, carry ? load(&carry[col]) : 0);
+			const auto m = lanes(mask);
+			store(&d[col], (load(&d[col]) & ~m) | (v & m));
+		};
+
+		const auto copyByte = [&](int16_t col) {
+			const auto v = value(s ? s[col] : 0, carry ? carry[col] : 0);
+			d[col] = static_cast<uint8_t>((d[col] & ~mask) | (v & mask));
+		};
+
+		if(!right_to_left)
+		{
+			for(int16_t w = 0; w < full_words; w++)
+			{
+				copyWord(static_cast<int16_t>(w * LANES));
+			}
+
+			for(int16_t col = full_words * LANES; col < dst.width; col++)
+			{
+				copyByte(col);
+			}
+		}
+		else
+		{
+			for(int16_t col = static_cast<int16_t>(dst.width - 1); col >= dst.width - tail; col--)
+			{
+				copyByte(col);
+			}
+
+			for(auto w = static_cast<int16_t>(full_words - 1); w >= 0; w--)
+			{
+				copyWord(static_cast<int16_t>(w * LANES));
+			}
+		}
+	}
+}
+
+void region::move(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, int16_t dst_x,
+				  int16_t dst_y, bool set) noexcept
+{
+	// Only pixels on the canvas are moved, so the destination is the clipped source
+	bounds r{x, y, width, height};
+	if(!clip(c, r))
+	{
+		return;
+	}
+
+	dst_x = static_cast<int16_t>(dst_x + r.x - x);
+	dst_y = static_cast<int16_t>(dst_y + r.y - y);
+	x = r.x;
+	y = r.y;
+	width = r.width;
+	height = r.height;
+
+	copy(c, x, y, width, height, dst_x, dst_y);
+
+	// Fill the part of the source that the destination does not cover: a band of whole rows
+	// above or below the destination, plus a band of columns beside it
+	const auto bottom = static_cast<int16_t>(y + height);
+	const auto dst_bottom = static_cast<int16_t>(dst_y + height);
+	const auto right = static_cast<int16_t>(x + width);
+	const auto dst_right = static_cast<int16_t>(dst_x + width);
+
+	if(dst_y > y)
+	{
+		const auto rows = static_cast<int16_t>(std::min(bottom, dst_y) - y);
+		fill(c, x, y, width, rows, set);
+	}
+	else if(dst_y < y)
+	{
+		const auto top = std::max(y, dst_bottom);
+		fill(c, x, top, width, static_cast<int16_t>(bottom - top), set);
+	}
+
+	const auto band_top = std::max(y, dst_y);
+	const auto band_rows = static_cast<int16_t>(std::min(bottom, dst_bottom) - band_top);
+	if(band_rows <= 0)
+	{
+		return;
+	}
+
+	if(dst_x > x)
+	{
+		const auto cols = static_cast<int16_t>(std::min(right, dst_x) - x);
+		fill(c, x, band_top, cols, band_rows, set);
+	}
+	else if(dst_x < x)
+	{
+		const auto left = std::max(x, dst_right);
+		fill(c, left, band_top, static_cast<int16_t>(right - left), band_rows, set);
+	}
+}
+
+void region::scroll(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, int16_t dx,
+					int16_t dy, bool set) noexcept
+{
+	// Scroll within the visible part of the rectangle, so content that is scrolled in from
+	// beyond the canvas edge is treated as vacated
+	bounds r{x, y, width, height};
+	if(!clip(c, r))
+	{
+		return;
+	}
+
+	x = r.x;
+	y = r.y;
+	width = r.width;
+	height = r.height;
+
+	if(abs(dx) >= width || abs(dy) >= height)
+	{
+		fill(c, x, y, width, height, set);
+		return;
+	}
+
+	// Only the part of the content which stays inside the rectangle is moved
+	const auto src_x = static_cast<int16_t>(x + std::max(0, -dx));
+	const auto src_y = static_cast<int16_t>(y + std::max(0, -dy));
+	const auto w = static_cast<int16_t>(width - abs(dx));
+	const auto h = static_cast<int16_t>(height - abs(dy));
+
+	copy(c, src_x, src_y, w, h, static_cast<int16_t>(src_x + dx), static_cast<int16_t>(src_y + dy));
+
+	// Fill the rows and columns vacated by the scroll
+	if(dy > 0)
+	{
+		fill(c, x, y, width, dy, set);
+	}
+	else if(dy < 0)
+	{
+		fill(c, x, static_cast<int16_t>(y + height + dy), width, static_cast<int16_t>(-dy), set);
+	}
+
+	if(dx > 0)
+	{
+		fill(c, x, y, dx, height, set);
+	}
+	else if(dx < 0)
+	{
+		fill(c, static_cast<int16_t>(x + width + dx), y, static_cast<int16_t>(-dx), height, set);
+	}
+}
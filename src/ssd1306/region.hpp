@@ -0,0 +1,51 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_REGION_HPP_
+#define SSD1306_REGION_HPP_
+
+#include "canvas.hpp"
+#include <cstdint>
+
+/** In-buffer operations on rectangular regions of a canvas
+ *
+ * These operate directly on the page-organized buffer, four columns at a time: a 32-bit word
+ * holds one page byte from each of four adjacent columns, so a row mask replicated into each
+ * byte lane applies to all four columns at once. Vertical moves shift each byte lane and merge
+ * in the bits carried over from the neighboring page.
+ *
+ * Rectangles are clipped to the canvas. Coordinates are signed so that partially off-canvas
+ * regions can be expressed.
+ */
+namespace embdrv::region
+{
+/// Invert the pixels in a rectangle
+void invert(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height) noexcept;
+
+/// Set or clear the pixels in a rectangle
+/// @param set True to turn the pixels on, false to turn them off.
+void fill(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, bool set) noexcept;
+
+/// Copy a rectangle to another position in the same canvas
+/// Overlapping source and destination rectangles are handled correctly.
+/// @param dst_x The left column of the destination.
+/// @param dst_y The top row of the destination.
+void copy(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, int16_t dst_x,
+		  int16_t dst_y) noexcept;
+
+/// Move a rectangle to another position, filling the uncovered part of the source
+/// @param set The value for the uncovered pixels: true for on, false for off.
+void move(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, int16_t dst_x,
+		  int16_t dst_y, bool set) noexcept;
+
+/// Scroll the contents of a rectangle, filling the vacated pixels
+/// Content scrolled past the edges of the rectangle is discarded.
+/// @param dx The number of columns to scroll by. Positive values scroll right.
+/// @param dy The number of rows to scroll by. Positive values scroll down.
+/// @param set The value for the vacated pixels: true for on, false for off.
+void scroll(canvas& c, int16_t x, int16_t y, int16_t width, int16_t height, int16_t dx,
+			int16_t dy, bool set) noexcept;
+
+} // namespace embdrv::region
+
+#endif // SSD1306_REGION_HPP_
@@ -4,6 +4,7 @@
 #include "ssd1306.hpp"
 #include "font/font5x7.h"
 #include "font/font8x16.h"
+#include "region.hpp"
 #include <algorithm>
 #include <bits/bits.hpp>
 #include <gsl/gsl-lite.hpp>
@@ -13,6 +14,10 @@ using namespace embdrv;
 /**
  * NOTE: the SSD1306 DOES NOT WORK WITH A REPEATED START
  * CONDITION There must be no start between the data byte and the data stream
+ *
+ * Other clients of the I2C master may start a transaction between any two of our transfers,
+ * so a control byte is never sent in a separate transfer from the bytes which follow it.
+ * Rows which are not contiguous in the screen buffer are staged in a bounce buffer instead.
  */
 
 const std::array<const uint8_t*, 2> ssd1306::fonts_ = {font5x7, font8x16};
@@ -24,6 +29,13 @@ constexpr uint8_t FONT_HEADER_SIZE = UINT8_C(6);
 
 uint8_t i2c_data_byte_ = UINT8_C(0x40);
 constexpr uint8_t I2C_COMMAND_REG = UINT8_C(0x0);
+// Control byte with the continuation (Co) bit set: a single command byte follows,
+// then another control byte.
+constexpr uint8_t I2C_COMMAND_CONTINUATION = UINT8_C(0x80);
+
+constexpr uint32_t MS_PER_SECOND = UINT32_C(1000);
+constexpr uint32_t FNV_OFFSET_BASIS = UINT32_C(2166136261);
+constexpr uint32_t FNV_PRIME = UINT32_C(16777619);
 
 constexpr uint8_t LCD_PAGE_HEIGHT = UINT8_C(8);
 constexpr uint8_t BITS_PER_ROW = UINT8_C(8);
@@ -52,7 +64,7 @@ constexpr uint8_t CHARGE_PUMP = UINT8_C(0x8D);
 constexpr uint8_t SET_ADDRESSING_MODE = UINT8_C(0x20);
 __attribute__((unused)) constexpr uint8_t PAGE_ADDRESSING_MODE = UINT8_C(0x2);
 constexpr uint8_t HORIZONTAL_ADDRESSING_MODE = UINT8_C(0x0);
-__attribute__((unused)) constexpr uint8_t VERTICAL_ADDRESSING_MODE = UINT8_C(0x1);
+constexpr uint8_t VERTICAL_ADDRESSING_MODE = UINT8_C(0x1);
 constexpr uint8_t SET_COLUMN_ADDRESS = UINT8_C(0x21);
 constexpr uint8_t SET_PAGE_ADDRESS = UINT8_C(0x22);
 
@@ -64,6 +76,9 @@ __attribute__((unused)) constexpr uint8_t SET_VERTICAL_SCROLL_AREA = UINT8_C(0xA
 __attribute__((unused)) constexpr uint8_t LEFT_HORIZONTAL_SCROLL = UINT8_C(0x27);
 __attribute__((unused)) constexpr uint8_t VERTICAL_RIGHT_HORIZONTAL_SCROLL = UINT8_C(0x29);
 __attribute__((unused)) constexpr uint8_t VERTICAL_LEFTHORIZONTALSCROLL = UINT8_C(0x2A);
+// Content scroll: shift the GDRAM contents by a single column
+__attribute__((unused)) constexpr uint8_t CONTENT_SCROLL_RIGHT = UINT8_C(0x2C);
+constexpr uint8_t CONTENT_SCROLL_LEFT = UINT8_C(0x2D);
 
 /* Unused Definitions
 #define WIDGETSTYLE0 0
@@ -80,11 +95,61 @@ __attribute__((unused)) constexpr uint8_t VERTICAL_LEFTHORIZONTALSCROLL = UINT8_
 
 void ssd1306::start_() noexcept
 {
-	// default 5x7 font
-	fontType(0);
-	drawColor(color::white);
-	drawMode(mode::normal);
-	cursor(0, 0);
+	wake();
+}
+
+void ssd1306::stop_() noexcept
+{
+	sleep();
+}
+
+void ssd1306::sleep() noexcept
+{
+	command(DISPLAY_OFF);
+	asleep_ = true;
+}
+
+void ssd1306::wake() noexcept
+{
+	asleep_ = false;
+	first_upload_ = true;
+
+	if(!initialized_)
+	{
+		// default 5x7 font
+		fontType(0);
+		drawColor(color::white);
+		drawMode(mode::normal);
+		cursor(0, 0);
+
+		initController();
+		initialized_ = true;
+
+		clear();
+		display();
+	}
+	else if(!controller_valid_)
+	{
+		// The controller may have been reset: GDRAM no longer holds the screen buffer
+		initController();
+		markAllDirty();
+		frame_hash_valid_ = false;
+		frame_pending_ = false;
+		uploadFrame(nullptr);
+	}
+	else if(frame_pending_ && !defer_uploads_ && max_fps_ == 0)
+	{
+		frame_pending_ = false;
+		uploadDirtyWindows();
+	}
+
+	command(DISPLAY_ON);
+}
+
+void ssd1306::initController() noexcept
+{
+	// Set before queueing, so a failure reported while the sequence is sent is not lost
+	controller_valid_ = true;
 
 	/**
 	 * Display init sequence
@@ -102,128 +167,378 @@ void ssd1306::start_() noexcept
 
 	// line # 0
 	command(SET_START_LINE | 0x0); // line #0
+	start_line_ = 0;
 
 	// Enable the charge pump
 	command(CHARGE_PUMP, 0x14); // NOLINT
 
-	command(NORMAL_DISPLAY);
+	// The user's settings, so re-initializing after a failure does not revert them
+	command(inverted_ ? INVERT_DISPLAY : NORMAL_DISPLAY);
 	command(DISPLAY_ALL_ON_RESUME);
 
-	command(SEG_REMAP | 0x1);
-	command(COM_SCAN_DEC);
+	command(flip_horizontal_ ? (SEG_REMAP | 0x0) : (SEG_REMAP | 0x1));
+	command(flip_vertical_ ? COM_SCAN_INC : COM_SCAN_DEC);
 
 	command(SET_COMP_INS, 0x12); // NOLINT
 
-	command(SET_CONTRAST, 0x08F); // NOLINT
+	command(SET_CONTRAST, contrast_);
 
 	command(SET_PRECHARGE, 0xF1); // NOLINT
 
 	command(SET_VCOM_DESELECT, 0x40); // NOLINT
 
-	command(SET_ADDRESSING_MODE);
-	command(HORIZONTAL_ADDRESSING_MODE);
+	command(SET_ADDRESSING_MODE, HORIZONTAL_ADDRESSING_MODE);
 
-	// Set the column limits for horizontal data mode
-	command(SET_COLUMN_ADDRESS, COLUMN_OFFSET, COLUMN_OFFSET + SCREEN_WIDTH - 1);
+	// Limit the columns and pages for a 64 x 48 display in horizontal data mode
+	restoreFullWindow();
+}
 
-	// Limit the pages for a 64 x 48 display
-	command(SET_PAGE_ADDRESS, 0, 5); // NOLINT
+embvm::i2c::status ssd1306::i2c_write(embvm::i2c::operation op, const uint8_t* buffer,
+									  uint16_t size, const embvm::i2c::master::cb_t& cb) noexcept
+{
+	embvm::i2c::op_t t;
+	t.op = op;
+	t.address = i2c_addr_;
+	t.tx_size = size;
+	t.tx_buffer = buffer;
 
-	clear();
-	display();
-	command(DISPLAY_ON);
+	return i2c_.transfer(t, cb);
 }
 
-void ssd1306::stop_() noexcept
+ssd1306::transfer_queue_t::descriptor* ssd1306::reserveTransfer(queue_policy policy,
+																size_t count) noexcept
 {
-	command(DISPLAY_OFF);
+	auto* d = tx_queue_.reserve(count);
+
+	const auto start_ms = waitStart();
+	while(d == nullptr && policy != queue_policy::drop && waitForTransfer(start_ms))
+	{
+		d = tx_queue_.reserve(count);
+	}
+
+	if(d == nullptr)
+	{
+		tx_queue_.recordDrop();
+
+		// The dropped transfer may have been part of a frame
+		markGdramStale();
+	}
+
+	return d;
 }
 
-void ssd1306::i2c_write(const uint8_t* buffer, uint8_t size,
-						const embvm::i2c::master::cb_t& cb) noexcept
+bool ssd1306::waitForTransfer(uint32_t start_ms) noexcept
 {
-	embvm::i2c::op_t t;
-	t.op = embvm::i2c::operation::write;
-	t.address = i2c_addr_;
-	t.tx_size = size;
-	t.tx_buffer = buffer;
+	// Slots are freed by the completion callback, so make sure a transfer is in flight
+	pumpTransferQueue();
+
+	if(wait_clock_ && (wait_clock_() - start_ms) >= wait_timeout_ms_)
+	{
+		return false;
+	}
 
-	i2c_.transfer(t, cb);
+	// Without a hook, completions arrive from interrupts while we spin
+	return wait_fn_ ? wait_fn_(wait_ctx_) : true;
 }
 
-void ssd1306::data(uint8_t c) noexcept
+void ssd1306::queueBytes(uint8_t control, const uint8_t* bytes, uint8_t count) noexcept
 {
-	auto* tx_buf = reinterpret_cast<uint8_t*>(i2c_pool_.create<uint16_t>());
-	assert(tx_buf);
+	assert(count < TRANSFER_PAYLOAD_SIZE);
 
-	tx_buf[0] = i2c_data_byte_;
-	tx_buf[1] = c;
+	transfer_queue_t::descriptor* d = nullptr;
 
-	i2c_write(tx_buf, sizeof(uint16_t), [&](auto op, auto status) {
-		(void)status;
-		// Static cast silences a GCC warning due to ptr cast changing alignment
-		// But our alignment is fine - we're adjusting our types to work with APIs, not actually
-		// changing alignment
-		i2c_pool_.destroy<uint16_t>(
-			reinterpret_cast<const uint16_t*>(static_cast<const void*>(op.tx_buffer)));
-	});
+	if(queue_policy_ == queue_policy::coalesce)
+	{
+		d = tx_queue_.coalesce(control, count);
+		if(d)
+		{
+			memcpy(&d->payload[d->size], bytes, count);
+			d->size += count;
+		}
+	}
+
+	if(d == nullptr)
+	{
+		d = reserveTransfer(queue_policy_);
+		if(d == nullptr)
+		{
+			// The controller configuration no longer matches what we sent
+			if(control == I2C_COMMAND_REG)
+			{
+				controller_valid_ = false;
+			}
+
+			return;
+		}
+
+		d->payload[0] = control;
+		memcpy(&d->payload[1], bytes, count);
+		d->size = count + 1;
+	}
+
+	tx_queue_.publish(d);
+	pumpTransferQueue();
 }
 
-void ssd1306::command(uint8_t cmd) noexcept
+bool ssd1306::queueBuffer(const uint8_t* buffer, uint16_t size,
+						  const embvm::i2c::master::cb_t& cb, queue_policy policy) noexcept
 {
-	auto* tx_buf = reinterpret_cast<uint8_t*>(i2c_pool_.create<uint16_t>());
-	assert(tx_buf);
+	auto* d = reserveTransfer(policy);
+	if(d == nullptr)
+	{
+		return false;
+	}
 
-	tx_buf[0] = I2C_COMMAND_REG;
-	tx_buf[1] = cmd;
+	d->buffer = buffer;
+	d->size = size;
+	d->cb = cb;
 
-	i2c_write(tx_buf, sizeof(uint16_t), [&](auto op, auto status) {
-		(void)status;
-		// Static cast silences a GCC warning due to ptr cast changing alignment
-		// But our alignment is fine - we're adjusting our types to work with APIs, not actually
-		// changing alignment
-		i2c_pool_.destroy<uint16_t>(
-			reinterpret_cast<const uint16_t*>(static_cast<const void*>(op.tx_buffer)));
-	});
+	tx_queue_.publish(d);
+	pumpTransferQueue();
+
+	return true;
 }
 
-void ssd1306::command(uint8_t cmd, uint8_t arg1) noexcept
+bool ssd1306::beginRows() noexcept
 {
-	auto* tx_buf = reinterpret_cast<uint8_t*>(i2c_pool_.create<uint32_t>());
-	assert(tx_buf);
+	// The rows of the previous upload are read while they are staged
+	const auto start_ms = waitStart();
+	while(rows_active_ && waitForTransfer(start_ms))
+	{
+	}
 
-	tx_buf[0] = I2C_COMMAND_REG;
-	tx_buf[1] = cmd;
-	tx_buf[2] = arg1;
+	if(rows_active_)
+	{
+		tx_queue_.recordDrop();
+		markGdramStale();
+		return false;
+	}
 
-	i2c_write(tx_buf, 3, [&](auto op, auto status) {
-		(void)status;
-		// Static cast silences a GCC warning due to ptr cast changing alignment
-		// But our alignment is fine - we're adjusting our types to work with APIs, not actually
-		// changing alignment
-		i2c_pool_.destroy<uint32_t>(
-			reinterpret_cast<const uint32_t*>(static_cast<const void*>(op.tx_buffer)));
-	});
+	rows_active_ = true;
+	row_count_ = 0;
+	return true;
 }
 
-void ssd1306::command(uint8_t cmd, uint8_t arg1, uint8_t arg2) noexcept
+void ssd1306::queueRows() noexcept
 {
-	auto* tx_buf = reinterpret_cast<uint8_t*>(i2c_pool_.create<uint32_t>());
-	assert(tx_buf);
+	if(row_count_ == 0)
+	{
+		rows_active_ = false;
+		return;
+	}
 
-	tx_buf[0] = I2C_COMMAND_REG;
-	tx_buf[1] = cmd;
-	tx_buf[2] = arg1;
-	tx_buf[3] = arg2;
+	// All rows are reserved together so that transfers queued after this call follow them
+	auto* d = reserveTransfer(queue_policy_ == queue_policy::drop ? queue_policy::drop
+																	: queue_policy::block,
+							  row_count_);
+	if(d == nullptr)
+	{
+		rows_active_ = false;
+		return;
+	}
+
+	row_descriptor_ = d;
+	row_next_ = 0;
+	stageNextRow();
+	pumpTransferQueue();
+}
+
+void ssd1306::stageNextRow() noexcept
+{
+	if(row_next_ == row_count_)
+	{
+		rows_active_ = false;
+		return;
+	}
 
-	i2c_write(tx_buf, sizeof(uint32_t), [&](auto op, auto status) {
+	const auto& row = rows_[row_next_++];
+	writeWindowHeader(row_buffer_, row.page, row.column, row.count);
+	memcpy(&row_buffer_[CHUNK_HEADER_SIZE], row.data, row.count);
+
+	// Every reserved row must be published, even after a failure, or the queue stalls
+	auto* d = row_descriptor_;
+	row_descriptor_ = tx_queue_.next(d);
+	d->buffer = row_buffer_;
+	d->size = CHUNK_HEADER_SIZE + row.count;
+	d->cb = [this](auto op, auto status) {
+		(void)op;
 		(void)status;
-		// Static cast silences a GCC warning due to ptr cast changing alignment
-		// But our alignment is fine - we're adjusting our types to work with APIs, not actually
-		// changing alignment
-		i2c_pool_.destroy<uint32_t>(
-			reinterpret_cast<const uint32_t*>(static_cast<const void*>(op.tx_buffer)));
-	});
+		stageNextRow();
+	};
+
+	tx_queue_.publish(d);
+}
+
+void ssd1306::writeWindowHeader(uint8_t* buffer, uint8_t page, uint8_t column,
+								uint8_t columns) noexcept
+{
+	const auto first_column = static_cast<uint8_t>(COLUMN_OFFSET + column);
+
+	const std::array<uint8_t, CHUNK_HEADER_SIZE> header = {
+		I2C_COMMAND_CONTINUATION,
+		SET_COLUMN_ADDRESS,
+		I2C_COMMAND_CONTINUATION,
+		first_column,
+		I2C_COMMAND_CONTINUATION,
+		static_cast<uint8_t>(first_column + columns - 1),
+		I2C_COMMAND_CONTINUATION,
+		SET_PAGE_ADDRESS,
+		I2C_COMMAND_CONTINUATION,
+		page,
+		I2C_COMMAND_CONTINUATION,
+		page,
+		i2c_data_byte_,
+	};
+
+	memcpy(buffer, header.data(), CHUNK_HEADER_SIZE);
+}
+
+void ssd1306::pumpTransferQueue() noexcept
+{
+	// A master which completes transfers synchronously calls transferComplete() from inside
+	// i2c_write(), and the completion queues and pumps the next transfer (e.g., the next chunk).
+	// Nested calls only request another pass of the outermost loop, so the stack depth does not
+	// grow with the number of transfers.
+	pump_requested_ = true;
+
+	while(pump_requested_ && !pumping_.exchange(true))
+	{
+		while(pump_requested_.exchange(false))
+		{
+			submitTransfer();
+		}
+
+		pumping_ = false;
+	}
+}
+
+void ssd1306::submitTransfer() noexcept
+{
+	while(!transfer_active_.exchange(true))
+	{
+		if(!tx_queue_.ready())
+		{
+			// Report the idle queue while we still own submission, so no transfer of ours can
+			// be submitted while the route is released
+			if(idle_fn_)
+			{
+				idle_fn_(submit_ctx_);
+			}
+
+			transfer_active_ = false;
+
+			// A producer may have published between our check and clearing the flag
+			if(!tx_queue_.ready())
+			{
+				return;
+			}
+
+			continue;
+		}
+
+		if(submit_fn_ && !submit_fn_(submit_ctx_))
+		{
+			// The transfer stays at the head of the queue until resumeTransfers()
+			transfer_active_ = false;
+			return;
+		}
+
+		// Only the consumer takes the head, so a ready head can always be acquired
+		auto* d = tx_queue_.acquire();
+		assert(d != nullptr);
+
+		SSD1306_STATS(transfer(d->size));
+		const auto result = i2c_write(d->op, d->data(), d->size, [this](auto op, auto status) {
+			transferComplete(op, status);
+		});
+
+		if(result != embvm::i2c::status::ok && result != embvm::i2c::status::enqueued)
+		{
+			// The master rejected the transfer without invoking the callback, so complete it
+			// here. The next transfer is submitted by the pump loop.
+			embvm::i2c::op_t op;
+			op.op = d->op;
+			op.address = i2c_addr_;
+			op.tx_buffer = d->data();
+			op.tx_size = d->size;
+			transferComplete(op, result);
+		}
+
+		return;
+	}
+}
+
+void ssd1306::transferComplete(embvm::i2c::op_t op, embvm::i2c::status status) noexcept
+{
+	// Copy the callback so the slot can be reused before we invoke it
+	auto cb = tx_queue_.front().cb;
+
+	if(status == embvm::i2c::status::ok)
+	{
+		bytes_sent_ += tx_queue_.front().size;
+	}
+
+	SSD1306_STATS(transferComplete(status == embvm::i2c::status::ok));
+
+	// A command may not have been applied, or the controller may have NACKed because it lost
+	// power: either way, its configuration and GDRAM contents can no longer be trusted
+	if(status != embvm::i2c::status::ok)
+	{
+		controller_valid_ = false;
+		markGdramStale();
+	}
+
+	tx_queue_.release();
+	transfer_active_ = false;
+
+	if(cb)
+	{
+		cb(op, status);
+	}
+
+	pumpTransferQueue();
+}
+
+void ssd1306::setWindow(uint8_t first_column, uint8_t last_column, uint8_t first_page,
+						uint8_t last_page) noexcept
+{
+	const std::array<uint8_t, 6> window = {
+		SET_COLUMN_ADDRESS,
+		static_cast<uint8_t>(COLUMN_OFFSET + first_column),
+		static_cast<uint8_t>(COLUMN_OFFSET + last_column),
+		SET_PAGE_ADDRESS,
+		first_page,
+		last_page,
+	};
+
+	queueBytes(I2C_COMMAND_REG, window.data(), window.size());
+}
+
+void ssd1306::restoreFullWindow() noexcept
+{
+	setWindow(0, SCREEN_WIDTH - 1, 0, SCREEN_PAGES - 1);
+}
+
+void ssd1306::data(uint8_t c) noexcept
+{
+	queueBytes(i2c_data_byte_, &c, 1);
+}
+
+void ssd1306::command(uint8_t cmd) noexcept
+{
+	queueBytes(I2C_COMMAND_REG, &cmd, 1);
+}
+
+void ssd1306::command(uint8_t cmd, uint8_t arg1) noexcept
+{
+	const std::array<uint8_t, 2> cmds = {cmd, arg1};
+	queueBytes(I2C_COMMAND_REG, cmds.data(), cmds.size());
+}
+
+void ssd1306::command(uint8_t cmd, uint8_t arg1, uint8_t arg2) noexcept
+{
+	const std::array<uint8_t, 3> cmds = {cmd, arg1, arg2};
+	queueBytes(I2C_COMMAND_REG, cmds.data(), cmds.size());
 }
 
 void ssd1306::putchar(uint8_t c) noexcept
@@ -237,7 +552,7 @@ void ssd1306::putchar(uint8_t c) noexcept
 	{
 		drawChar(cursorX_, cursorY_, c, color_, mode_);
 		cursorX_ += fontWidth_ + 1;
-		if((cursorX_ > (SCREEN_WIDTH - fontWidth_)))
+		if((cursorX_ > (target_->width() - fontWidth_)))
 		{
 			cursorY_ += fontHeight_;
 			cursorX_ = 0;
@@ -258,18 +573,26 @@ void ssd1306::clear() noexcept
 
 void ssd1306::clear(uint8_t c) noexcept
 {
-	memset(screen_buffer_, c, SCREEN_BUFFER_SIZE); // (64 x 48) / 8 = 384
+	SSD1306_STATS_SCOPE(ssd1306_op::clear);
+
+	target_->fill(c); // (64 x 48) / 8 = 384 for the screen
+
+	if(target_ == &screen_)
+	{
+		markAllDirty();
+	}
 }
 
 void ssd1306::invert(enum invert inv) noexcept
 {
-	command(inv == invert::normal ? NORMAL_DISPLAY : INVERT_DISPLAY);
+	inverted_ = inv != invert::normal;
+	command(inverted_ ? INVERT_DISPLAY : NORMAL_DISPLAY);
 }
 
 void ssd1306::contrast(uint8_t contrast) noexcept
 {
-	command(SET_CONTRAST); // 0x81
-	command(contrast);
+	contrast_ = contrast;
+	command(SET_CONTRAST, contrast);
 }
 
 void ssd1306::cursor(coord_t x, coord_t y) noexcept
@@ -280,24 +603,35 @@ void ssd1306::cursor(coord_t x, coord_t y) noexcept
 
 void ssd1306::pixel(coord_t x, coord_t y, color c, mode m) noexcept
 {
-	if((x >= SCREEN_WIDTH) || (y >= SCREEN_HEIGHT))
+	SSD1306_STATS_SCOPE(ssd1306_op::pixel);
+
+	if((x >= target_->width()) || (y >= target_->height()))
 	{
 		return;
 	}
 
+	if(target_ == &screen_)
+	{
+		markDirty(y / BITS_PER_ROW, x, x);
+	}
+
+	SSD1306_STATS(pixel());
+
+	auto* b = target_->page(y / BITS_PER_ROW, x);
+
 	if(m == mode::XOR && c == color::white)
 	{
-		screen_buffer_[x + (y / BITS_PER_ROW) * SCREEN_WIDTH] ^= SET_BIT((y % BITS_PER_ROW));
+		*b ^= SET_BIT((y % BITS_PER_ROW));
 	}
 	else
 	{
 		if(c == color::white)
 		{
-			screen_buffer_[x + (y / BITS_PER_ROW) * SCREEN_WIDTH] |= SET_BIT((y % BITS_PER_ROW));
+			*b |= SET_BIT((y % BITS_PER_ROW));
 		}
 		else
 		{
-			screen_buffer_[x + (y / BITS_PER_ROW) * SCREEN_WIDTH] &= ~SET_BIT((y % BITS_PER_ROW));
+			*b &= ~SET_BIT((y % BITS_PER_ROW));
 		}
 	}
 }
@@ -305,6 +639,8 @@ void ssd1306::pixel(coord_t x, coord_t y, color c, mode m) noexcept
 // TODO: cleanup
 void ssd1306::line(coord_t x0, coord_t y0, coord_t x1, coord_t y1, color c, mode m) noexcept
 {
+	SSD1306_STATS_SCOPE(ssd1306_op::line);
+
 	auto steep = static_cast<uint8_t>(abs(y1 - y0) > abs(x1 - x0));
 	if(steep != 0)
 	{
@@ -356,6 +692,8 @@ void ssd1306::line(coord_t x0, coord_t y0, coord_t x1, coord_t y1, color c, mode
 
 void ssd1306::rect(coord_t x, coord_t y, uint8_t width, uint8_t height, color c, mode m) noexcept
 {
+	SSD1306_STATS_SCOPE(ssd1306_op::rect);
+
 	uint8_t tempHeight = 0;
 
 	lineH(x, y, width, c, m);
@@ -375,6 +713,8 @@ void ssd1306::rect(coord_t x, coord_t y, uint8_t width, uint8_t height, color c,
 void ssd1306::rectFill(coord_t x, coord_t y, uint8_t width, uint8_t height, color c,
 					   mode m) noexcept
 {
+	SSD1306_STATS_SCOPE(ssd1306_op::rectFill);
+
 	for(uint8_t i = x; i < x + width; i++)
 	{
 		lineV(i, y, height, c, m);
@@ -383,6 +723,8 @@ void ssd1306::rectFill(coord_t x, coord_t y, uint8_t width, uint8_t height, colo
 
 void ssd1306::circle(coord_t x, coord_t y, uint8_t radius, color c, mode m) noexcept
 {
+	SSD1306_STATS_SCOPE(ssd1306_op::circle);
+
 	// TODO - find a way to check for no overlapping of pixels so that XOR draw mode will work
 	// perfectly
 	int8_t f = 1 - static_cast<int8_t>(radius);
@@ -423,6 +765,8 @@ void ssd1306::circle(coord_t x, coord_t y, uint8_t radius, color c, mode m) noex
 // TODO: refactor so function inputs are x, y
 void ssd1306::circleFill(coord_t x, coord_t y, uint8_t radius, color c, mode m) noexcept
 {
+	SSD1306_STATS_SCOPE(ssd1306_op::circleFill);
+
 	// TODO - - find a way to check for no overlapping of pixels so that XOR draw mode will work
 	// perfectly
 	int8_t f = 1 - static_cast<int8_t>(radius);
@@ -549,6 +893,8 @@ void ssd1306::drawCharMultiRow(coord_t x, coord_t y, uint8_t character, color c,
 // multiple of 8 pixels. Also fix 5x7
 void ssd1306::drawChar(coord_t x, coord_t y, uint8_t character, color c, mode m) noexcept
 {
+	SSD1306_STATS_SCOPE(ssd1306_op::drawChar);
+
 	// Check that we have a bitmap for the required c
 	assert((character >= fontStartChar_) && (character < fontStartChar_ + fontTotalChar_ - 1));
 
@@ -568,7 +914,160 @@ void ssd1306::drawChar(coord_t x, coord_t y, uint8_t character, color c, mode m)
 
 void ssd1306::drawBitmap(uint8_t* bitmap) noexcept
 {
-	memcpy(screen_buffer_, bitmap, SCREEN_BUFFER_SIZE);
+	SSD1306_STATS_SCOPE(ssd1306_op::drawBitmap);
+
+	memcpy(target_->buffer(), bitmap, target_->size());
+
+	if(target_ == &screen_)
+	{
+		markAllDirty();
+	}
+}
+
+template<typename TPoints, typename TUnpack, typename TOp>
+void ssd1306::plotPoints(const TPoints& points, const TUnpack& unpack, const TOp& op) noexcept
+{
+	const auto width = target_->width();
+	const auto height = target_->height();
+	auto* const buffer = target_->buffer();
+	const bool screen = target_ == &screen_;
+
+	page_columns_t first;
+	page_columns_t last;
+	first.fill(SCREEN_WIDTH);
+	last.fill(0);
+
+	uint32_t plotted = 0;
+
+	for(const auto& p : points)
+	{
+		const point pt = unpack(p);
+		if(pt.x >= width || pt.y >= height)
+		{
+			continue;
+		}
+
+		const auto page = static_cast<uint8_t>(pt.y / BITS_PER_ROW);
+		op(buffer[(page * width) + pt.x], static_cast<uint8_t>(SET_BIT(pt.y % BITS_PER_ROW)));
+		plotted++;
+
+		if(screen)
+		{
+			first[page] = std::min(first[page], pt.x);
+			last[page] = std::max(last[page], pt.x);
+		}
+	}
+
+	SSD1306_STATS(pixel(plotted));
+	(void)plotted;
+
+	if(screen)
+	{
+		for(uint8_t page = 0; page < SCREEN_PAGES; page++)
+		{
+			if(first[page] <= last[page])
+			{
+				markDirty(page, first[page], last[page]);
+			}
+		}
+	}
+}
+
+template<typename TPoints, typename TUnpack>
+void ssd1306::plotPoints(const TPoints& points, const TUnpack& unpack, color c, mode m) noexcept
+{
+	if(m == mode::XOR && c == color::white)
+	{
+		plotPoints(points, unpack, [](uint8_t& b, uint8_t bit) { b ^= bit; });
+	}
+	else if(c == color::white)
+	{
+		plotPoints(points, unpack, [](uint8_t& b, uint8_t bit) { b |= bit; });
+	}
+	else
+	{
+		plotPoints(points, unpack,
+				   [](uint8_t& b, uint8_t bit) { b &= static_cast<uint8_t>(~bit); });
+	}
+}
+
+void ssd1306::pixels(gsl::span<const point> points, color c, mode m) noexcept
+{
+	SSD1306_STATS_SCOPE(ssd1306_op::pixels);
+
+	plotPoints(points, [](const point& p) { return p; }, c, m);
+}
+
+void ssd1306::pixels(gsl::span<const uint16_t> points, color c, mode m) noexcept
+{
+	SSD1306_STATS_SCOPE(ssd1306_op::pixels);
+
+	plotPoints(
+		points,
+		[](uint16_t p) {
+			return point{static_cast<uint8_t>(p >> 8), static_cast<uint8_t>(p & 0xFF)}; // NOLINT
+		},
+		c, m);
+}
+
+void ssd1306::invertRegion(coord_t x, coord_t y, uint8_t width, uint8_t height) noexcept
+{
+	SSD1306_STATS_SCOPE(ssd1306_op::region);
+
+	region::invert(*target_, x, y, width, height);
+	markRegionDirty(x, y, width, height);
+}
+
+void ssd1306::copyRegion(coord_t x, coord_t y, uint8_t width, uint8_t height, coord_t dst_x,
+						 coord_t dst_y) noexcept
+{
+	SSD1306_STATS_SCOPE(ssd1306_op::region);
+
+	region::copy(*target_, x, y, width, height, dst_x, dst_y);
+	markRegionDirty(dst_x, dst_y, width, height);
+}
+
+void ssd1306::moveRegion(coord_t x, coord_t y, uint8_t width, uint8_t height, coord_t dst_x,
+						 coord_t dst_y, color fill) noexcept
+{
+	SSD1306_STATS_SCOPE(ssd1306_op::region);
+
+	region::move(*target_, x, y, width, height, dst_x, dst_y, fill == color::white);
+	markRegionDirty(x, y, width, height);
+	markRegionDirty(dst_x, dst_y, width, height);
+}
+
+void ssd1306::scrollRegion(coord_t x, coord_t y, uint8_t width, uint8_t height, int8_t dx,
+						   int8_t dy, color fill) noexcept
+{
+	SSD1306_STATS_SCOPE(ssd1306_op::region);
+
+	region::scroll(*target_, x, y, width, height, dx, dy, fill == color::white);
+	markRegionDirty(x, y, width, height);
+}
+
+void ssd1306::markRegionDirty(int16_t x, int16_t y, int16_t width, int16_t height) noexcept
+{
+	if(target_ != &screen_)
+	{
+		return;
+	}
+
+	const auto first_column = std::max<int>(x, 0);
+	const auto last_column = std::min<int>(x + width, SCREEN_WIDTH) - 1;
+	const auto first_row = std::max<int>(y, 0);
+	const auto last_row = std::min<int>(y + height, SCREEN_HEIGHT) - 1;
+
+	if(first_column > last_column || first_row > last_row)
+	{
+		return;
+	}
+
+	for(auto page = first_row / BITS_PER_ROW; page <= last_row / BITS_PER_ROW; page++)
+	{
+		markDirty(static_cast<uint8_t>(page), static_cast<uint8_t>(first_column),
+				  static_cast<uint8_t>(last_column));
+	}
 }
 
 uint8_t ssd1306::screenWidth() const noexcept
@@ -589,15 +1088,20 @@ void ssd1306::scrollRight(coord_t start, coord_t stop) noexcept
 
 	scrollStop(); // need to disable scrolling before starting to avoid memory corrupt
 
-	command(RIGHT_HORIZONTAL_SCROLL);
-	command(0x00);
-	command(start);
-	// NOLINTNEXTLINE
-	command(0x7); // scroll speed frames , TODO
-	command(stop);
-	command(0x00);
-	command(0xFF); // NOLINT
-	command(ACTIVATE_SCROLL);
+	// The setup is sent as one transfer, so no other transfer can split a command from its
+	// arguments
+	const std::array<uint8_t, 8> scroll = {
+		RIGHT_HORIZONTAL_SCROLL,
+		0x00, // dummy
+		start, // start page
+		0x7, // NOLINT: scroll speed frames, TODO
+		stop, // end page
+		0x00, // dummy
+		0xFF, // NOLINT: dummy
+		ACTIVATE_SCROLL,
+	};
+
+	queueBytes(I2C_COMMAND_REG, scroll.data(), scroll.size());
 }
 
 // TODO
@@ -631,22 +1135,489 @@ void ssd1306::scrollStop() noexcept
 
 void ssd1306::flipVertical(bool flip) noexcept
 {
+	flip_vertical_ = flip;
 	command(flip ? COM_SCAN_INC : COM_SCAN_DEC);
 }
 
 void ssd1306::flipHorizontal(bool flip) noexcept
 {
+	flip_horizontal_ = flip;
 	command(flip ? (SEG_REMAP | 0x0) : (SEG_REMAP | 0x1));
 }
 
 void ssd1306::display() noexcept
 {
-	embvm::i2c::op_t t;
-	t.op = embvm::i2c::operation::write;
-	t.address = i2c_addr_;
-	t.tx_size = sizeof(display_buffer_);
-	t.tx_buffer = display_buffer_;
-	i2c_.transfer(t);
+	SSD1306_STATS_SCOPE(ssd1306_op::display);
+
+	if(defer_uploads_ || max_fps_ != 0 || asleep_)
+	{
+		frame_pending_ = true;
+		return;
+	}
+
+	uploadFrame(nullptr);
+}
+
+void ssd1306::uploadFrame(const embvm::i2c::master::cb_t& done) noexcept
+{
+	assert(!column_stream_ && "Call endColumnStream() before uploading a frame");
+
+	// Mirror here rather than in display(), so frames uploaded by a scheduler are mirrored too
+	if(mirror_)
+	{
+		mirror_->update(screen_);
+	}
+
+	frame_pending_ = false;
+	reclaimController();
+	reclaimStaleGdram();
+
+	if(start_line_ != 0)
+	{
+		command(SET_START_LINE | 0x0);
+		start_line_ = 0;
+	}
+
+	if(chunk_columns_ != 0)
+	{
+		// Hand the modified columns over to the chunked upload. While an upload is in progress,
+		// we only widen its ranges: the completion context may be reading them.
+		for(uint8_t page = 0; page < SCREEN_PAGES; page++)
+		{
+			if(upload_active_)
+			{
+				upload_first_[page] = std::min(upload_first_[page], dirty_first_[page]);
+				upload_last_[page] = std::max(upload_last_[page], dirty_last_[page]);
+			}
+			else
+			{
+				upload_first_[page] = dirty_first_[page];
+				upload_last_[page] = dirty_last_[page];
+			}
+		}
+
+		clearDirty();
+
+		// If an upload is in progress, this callback is invoked once the restarted upload
+		// (which contains the latest frame) completes. The callback must be registered before
+		// the upload is requested, see startChunkedUpload().
+		if(done && !addFrameCallback(done))
+		{
+			done(frameOp(), embvm::i2c::status::busy);
+		}
+
+		upload_requested_ = true;
+		if(!upload_active_.exchange(true))
+		{
+			startChunkedUpload(queue_policy::block);
+		}
+
+		return;
+	}
+
+	clearDirty();
+	if(!queueBuffer(display_buffer_, sizeof(display_buffer_), done, queue_policy::block))
+	{
+		// The frame was dropped: send it with the next upload
+		markAllDirty();
+
+		if(done)
+		{
+			done(frameOp(), embvm::i2c::status::busy);
+		}
+	}
+}
+
+void ssd1306::uploadDirtyWindows() noexcept
+{
+	if(chunk_columns_ != 0)
+	{
+		uploadFrame(nullptr);
+		return;
+	}
+
+	assert(!column_stream_ && "Call endColumnStream() before uploading a frame");
+
+	if(mirror_)
+	{
+		mirror_->update(screen_);
+	}
+
+	reclaimController();
+	reclaimStaleGdram();
+
+	if(start_line_ != 0)
+	{
+		command(SET_START_LINE | 0x0);
+		start_line_ = 0;
+	}
+
+	if(!beginRows())
+	{
+		return;
+	}
+
+	for(uint8_t page = 0; page < SCREEN_PAGES; page++)
+	{
+		const auto first = dirty_first_[page];
+		if(first <= dirty_last_[page])
+		{
+			addRow(page, first, &screen_buffer_[(page * SCREEN_WIDTH) + first],
+				   static_cast<uint8_t>(dirty_last_[page] - first + 1));
+		}
+	}
+
+	queueRows();
+	restoreFullWindow();
+
+	clearDirty();
+}
+
+void ssd1306::tick(uint32_t now_ms) noexcept
+{
+	if(max_fps_ == 0 || !frame_pending_ || upload_active_ || asleep_)
+	{
+		return;
+	}
+
+	if(!first_upload_ && (now_ms - last_upload_ms_) < (MS_PER_SECOND / max_fps_))
+	{
+		return;
+	}
+
+	frame_pending_ = false;
+	reclaimStaleGdram();
+
+	if(!isDirty())
+	{
+		return;
+	}
+
+	// Frames are often cleared and redrawn with the same contents
+	const auto hash = frameHash();
+	if(frame_hash_valid_ && hash == last_frame_hash_)
+	{
+		clearDirty();
+		return;
+	}
+
+	last_frame_hash_ = hash;
+	frame_hash_valid_ = true;
+	last_upload_ms_ = now_ms;
+	first_upload_ = false;
+	uploadFrame(nullptr);
+}
+
+#if SSD1306_ENABLE_STATS
+ssd1306_stats ssd1306::stats() const noexcept
+{
+	auto s = stats_.stats();
+	const auto q = tx_queue_.stats();
+	s.queue_occupancy = static_cast<uint32_t>(tx_queue_.size());
+	s.queue_high_water_mark = q.high_water_mark;
+	return s;
+}
+
+void ssd1306::resetStats() noexcept
+{
+	stats_.reset();
+	tx_queue_.resetStats();
+}
+#endif
+
+void ssd1306::displayViewport(const canvas& c, coord_t x, coord_t y) noexcept
+{
+	assert(c.width() >= SCREEN_WIDTH && c.height() >= SCREEN_HEIGHT);
+	assert(!upload_active_);
+
+	x = static_cast<coord_t>(std::min<int>(x, c.width() - SCREEN_WIDTH));
+	y = static_cast<coord_t>(std::min<int>(y, c.height() - SCREEN_HEIGHT));
+
+	const auto first_page = static_cast<uint8_t>(y / BITS_PER_ROW);
+	const auto start_line = static_cast<uint8_t>(y % BITS_PER_ROW);
+
+	// With a start line offset, the visible rows span one additional page of GDRAM
+	const auto pages = static_cast<uint8_t>(start_line ? SCREEN_PAGES + 1 : SCREEN_PAGES);
+
+	if(!beginRows())
+	{
+		return;
+	}
+
+	for(uint8_t page = 0; page < pages; page++)
+	{
+		addRow(page, 0, c.page(first_page + page, x), SCREEN_WIDTH);
+	}
+
+	queueRows();
+
+	command(SET_START_LINE | start_line);
+	start_line_ = start_line;
+
+	restoreFullWindow();
+
+	// The controller no longer holds the contents of the screen buffer
+	markAllDirty();
+	frame_hash_valid_ = false;
+}
+
+void ssd1306::beginColumnStream() noexcept
+{
+	assert(!upload_active_);
+
+	// Content scrolling requires continuous scrolling to be disabled
+	command(DEACTIVATE_SCROLL);
+	command(SET_ADDRESSING_MODE, VERTICAL_ADDRESSING_MODE);
+	columnStreamWindow(SCREEN_WIDTH - 1, SCREEN_WIDTH - 1);
+
+	column_stream_ = true;
+
+	// The controller no longer holds the contents of the screen buffer
+	markAllDirty();
+	frame_hash_valid_ = false;
+}
+
+void ssd1306::columnStreamWindow(coord_t first, coord_t last) noexcept
+{
+	assert(first <= last && last < SCREEN_WIDTH);
+
+	setWindow(first, last, 0, SCREEN_PAGES - 1);
+}
+
+void ssd1306::streamColumn(const uint8_t* column) noexcept
+{
+	queueBytes(i2c_data_byte_, column, SCREEN_PAGES);
+}
+
+void ssd1306::streamCanvas(const canvas& c) noexcept
+{
+	assert(c.width() >= SCREEN_WIDTH && c.height() >= SCREEN_HEIGHT);
+	assert(column_stream_);
+
+	if(!beginRows())
+	{
+		return;
+	}
+
+	// A window of a single page fills the columns of that page, even in vertical addressing
+	for(uint8_t page = 0; page < SCREEN_PAGES; page++)
+	{
+		addRow(page, 0, c.page(page, 0), SCREEN_WIDTH);
+	}
+
+	queueRows();
+	columnStreamWindow(SCREEN_WIDTH - 1, SCREEN_WIDTH - 1);
+}
+
+void ssd1306::scrollColumnsLeft() noexcept
+{
+	const std::array<uint8_t, 8> scroll = {
+		CONTENT_SCROLL_LEFT,
+		0x00, // dummy
+		0, // start page
+		0x01, // dummy
+		SCREEN_PAGES - 1, // end page
+		0x00, // dummy
+		COLUMN_OFFSET, // start column
+		COLUMN_OFFSET + SCREEN_WIDTH - 1, // end column
+	};
+
+	queueBytes(I2C_COMMAND_REG, scroll.data(), scroll.size());
+}
+
+void ssd1306::endColumnStream() noexcept
+{
+	command(SET_ADDRESSING_MODE, HORIZONTAL_ADDRESSING_MODE);
+	restoreFullWindow();
+
+	column_stream_ = false;
+}
+
+bool ssd1306::isDirty() const noexcept
+{
+	for(uint8_t page = 0; page < SCREEN_PAGES; page++)
+	{
+		if(dirty_first_[page] <= dirty_last_[page])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t ssd1306::frameHash() const noexcept
+{
+	// 32-bit FNV-1a
+	uint32_t hash = FNV_OFFSET_BASIS;
+	for(size_t i = 0; i < SCREEN_BUFFER_SIZE; i++)
+	{
+		hash = (hash ^ screen_buffer_[i]) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+uint16_t ssd1306::frameTransferSize() const noexcept
+{
+	if(chunk_columns_ == 0)
+	{
+		return sizeof(display_buffer_);
+	}
+
+	const auto chunks_per_page = (SCREEN_WIDTH + chunk_columns_ - 1) / chunk_columns_;
+	return SCREEN_BUFFER_SIZE + (SCREEN_PAGES * chunks_per_page * CHUNK_HEADER_SIZE);
+}
+
+void ssd1306::uploadChunkSize(uint8_t columns) noexcept
+{
+	assert(!upload_active_ && "Chunk size cannot be changed during an upload");
+
+	// Chunks never span pages
+	chunk_columns_ = std::min(columns, SCREEN_WIDTH);
+
+	if(chunk_columns_ == 0)
+	{
+		// Chunked uploads leave a partial window set
+		restoreFullWindow();
+	}
+}
+
+bool ssd1306::addFrameCallback(const embvm::i2c::master::cb_t& cb) noexcept
+{
+	const auto tail = frame_cb_tail_.load();
+	if(tail - frame_cb_head_.load() == FRAME_CALLBACK_SLOTS)
+	{
+		return false;
+	}
+
+	frame_cbs_[tail % FRAME_CALLBACK_SLOTS] = cb;
+	frame_cb_tail_ = tail + 1;
+	return true;
+}
+
+void ssd1306::markGdramStale() noexcept
+{
+	frame_hash_valid_ = false;
+	gdram_stale_ = true;
+}
+
+void ssd1306::reclaimController() noexcept
+{
+	// While asleep, wake() re-initializes the controller
+	if(controller_valid_ || !initialized_ || asleep_)
+	{
+		return;
+	}
+
+	initController();
+	markAllDirty();
+	frame_hash_valid_ = false;
+	command(DISPLAY_ON);
+}
+
+void ssd1306::reclaimStaleGdram() noexcept
+{
+	if(gdram_stale_.exchange(false))
+	{
+		markAllDirty();
+	}
+}
+
+void ssd1306::startChunkedUpload(queue_policy policy) noexcept
+{
+	upload_requested_ = false;
+
+	// Callbacks registered from here on wait for the next upload
+	frame_cb_end_ = frame_cb_tail_.load();
+	chunk_page_ = 0;
+	chunk_column_ = 0;
+	sendNextChunk(policy);
+}
+
+void ssd1306::sendNextChunk(queue_policy policy) noexcept
+{
+	// Advance to the next modified column, skipping clean pages
+	while(chunk_page_ < SCREEN_PAGES)
+	{
+		chunk_column_ = std::max(chunk_column_, upload_first_[chunk_page_]);
+		if(chunk_column_ <= upload_last_[chunk_page_])
+		{
+			break;
+		}
+
+		chunk_column_ = 0;
+		chunk_page_++;
+	}
+
+	if(chunk_page_ == SCREEN_PAGES)
+	{
+		finishChunkedUpload(embvm::i2c::status::ok);
+		return;
+	}
+
+	// The last chunk in a modified range is truncated to the end of the range
+	const auto columns = static_cast<uint8_t>(
+		std::min<int>(chunk_columns_, upload_last_[chunk_page_] - chunk_column_ + 1));
+
+	writeWindowHeader(chunk_buffer_, chunk_page_, chunk_column_, columns);
+	memcpy(&chunk_buffer_[CHUNK_HEADER_SIZE],
+		   &screen_buffer_[(chunk_page_ * SCREEN_WIDTH) + chunk_column_], columns);
+
+	chunk_column_ += columns;
+
+	const bool queued = queueBuffer(chunk_buffer_, CHUNK_HEADER_SIZE + columns,
+									[this](auto op, auto status) {
+										(void)op;
+
+										// The failed chunk marked GDRAM as stale, so the next
+										// upload sends the whole frame again
+										if(status != embvm::i2c::status::ok)
+										{
+											finishChunkedUpload(status);
+											return;
+										}
+
+										// We are in the completion context, so we cannot block
+										sendNextChunk(queue_policy::drop);
+									},
+									policy);
+
+	if(!queued)
+	{
+		finishChunkedUpload(embvm::i2c::status::busy);
+	}
+}
+
+void ssd1306::finishChunkedUpload(embvm::i2c::status status) noexcept
+{
+	// Notify the callbacks which were registered before this upload started
+	for(auto head = frame_cb_head_.load(); head != frame_cb_end_; head++)
+	{
+		auto cb = frame_cbs_[head % FRAME_CALLBACK_SLOTS];
+		frame_cbs_[head % FRAME_CALLBACK_SLOTS] = nullptr;
+		frame_cb_head_ = head + 1;
+
+		cb(frameOp(), status);
+	}
+
+	upload_active_ = false;
+
+	// display() was called while we were uploading - send the new frame
+	if(upload_requested_ && !upload_active_.exchange(true))
+	{
+		startChunkedUpload(queue_policy::drop);
+	}
+}
+
+embvm::i2c::op_t ssd1306::frameOp() const noexcept
+{
+	embvm::i2c::op_t op;
+	op.op = embvm::i2c::operation::write;
+	op.address = i2c_addr_;
+	op.tx_buffer = screen_buffer_;
+	op.tx_size = SCREEN_BUFFER_SIZE;
+	return op;
 }
 
 uint8_t ssd1306::fontType(uint8_t type) noexcept
@@ -4,9 +4,17 @@
 #ifndef SSD1306_HPP_
 #define SSD1306_HPP_
 
+#include "canvas.hpp"
+#include "frame_mirror.hpp"
+#include "ssd1306_stats.hpp"
+#include "transfer_queue.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <driver/basic_display.hpp>
 #include <driver/i2c.hpp>
-#include <etl/variant_pool.h>
+#include <gsl/gsl-lite.hpp>
 
 namespace embdrv
 {
@@ -27,6 +35,32 @@ inline constexpr uint8_t DEFAULT_SSD1306_I2C_ADDR = 0x3C;
 class ssd1306 final : public embvm::basicDisplay
 {
   public:
+	/// The width of the screen in pixels
+	static constexpr uint8_t SCREEN_WIDTH = 64;
+
+	/// The height of the screen in pixels
+	static constexpr uint8_t SCREEN_HEIGHT = 48;
+
+	/// The number of pages (8-pixel tall rows) on the screen
+	static constexpr uint8_t SCREEN_PAGES = SCREEN_HEIGHT / 8;
+
+	/// Transfer wait hook, see transferWaitHook()
+	/// @param ctx The context pointer supplied with the hook.
+	/// @returns true to keep waiting, false to give up.
+	using transfer_wait_fn_t = bool (*)(void* ctx);
+
+	/// Millisecond clock, see transferWaitTimeout()
+	using clock_ms_fn_t = uint32_t (*)();
+
+	/// Pre-submit hook, see submitHook()
+	/// @param ctx The context pointer supplied with the hook.
+	/// @returns true to submit the transfer, false to hold it until resumeTransfers() is called.
+	using submit_fn_t = bool (*)(void* ctx);
+
+	/// Idle hook, see submitHook()
+	/// @param ctx The context pointer supplied with the hook.
+	using idle_fn_t = void (*)(void* ctx);
+
 	/// Address is 0x3D if DC pin is set to 1
 	explicit ssd1306(embvm::i2c::master& i2c, uint8_t i2c_addr = DEFAULT_SSD1306_I2C_ADDR)
 		: i2c_(i2c), i2c_addr_(i2c_addr)
@@ -35,6 +69,9 @@ class ssd1306 final : public embvm::basicDisplay
 		// Data payload. This is used to transfer the whole screen buffer in a
 		// Single transaction.
 		display_buffer_[0] = 0x40; // NOLINT
+
+		// The controller contents are unknown until the first upload
+		markAllDirty();
 	}
 
 	void clear() noexcept final;
@@ -51,6 +88,24 @@ class ssd1306 final : public embvm::basicDisplay
 	void circleFill(coord_t x, coord_t y, uint8_t radius, color c, mode m) noexcept final;
 	void drawChar(coord_t x, coord_t y, uint8_t character, color c, mode m) noexcept final;
 	void drawBitmap(uint8_t* bitmap) noexcept final;
+
+	/** Plot a batch of points on the target canvas
+	 *
+	 * This is equivalent to calling pixel() for each point, but the color and mode are resolved
+	 * once for the batch, and the modified columns are accumulated locally and merged into the
+	 * dirty ranges once at the end. Points outside of the target canvas are skipped.
+	 *
+	 * @param points The points to plot.
+	 * @param c The color to plot the points with.
+	 * @param m The drawing mode. With mode::XOR, a point which appears twice is cleared again.
+	 */
+	void pixels(gsl::span<const point> points, color c, mode m) noexcept;
+
+	/// Plot a batch of packed points on the target canvas
+	/// @param points The points to plot, packed with packPoint().
+	/// @param c The color to plot the points with.
+	/// @param m The drawing mode.
+	void pixels(gsl::span<const uint16_t> points, color c, mode m) noexcept;
 	uint8_t screenWidth() const noexcept final;
 	uint8_t screenHeight() const noexcept final;
 
@@ -65,6 +120,406 @@ class ssd1306 final : public embvm::basicDisplay
 
 	void display() noexcept final;
 
+	/** Configure chunked frame uploads
+	 *
+	 * By default, display() sends the whole screen buffer in a single I2C write, which holds
+	 * the bus for the duration of the frame (~9 ms at 400 kHz). When a chunk size is set,
+	 * display() instead splits the frame into chunks of `columns` bytes within a single page.
+	 * Each chunk is an independent write which re-issues the column/page window, and the next
+	 * chunk is only queued once the previous one completes. Other transactions queued on the
+	 * same I2C master are serviced in between chunks, bounding our per-chunk bus occupancy.
+	 *
+	 * Chunked uploads only send the columns which were modified since the previous upload.
+	 * Drawing while a chunked upload is in progress may result in a torn frame on the panel.
+	 * Calling display() while an upload is in progress schedules another upload once the
+	 * current one completes. The chunk size must not be changed while an upload is in progress.
+	 *
+	 * @param columns The number of columns to send per chunk, clamped to the screen width.
+	 *	A value of 0 disables chunking and restores single-transfer uploads.
+	 */
+	void uploadChunkSize(uint8_t columns) noexcept;
+
+	/// Get the current upload chunk size
+	/// @returns the number of columns sent per chunk, or 0 if chunking is disabled.
+	uint8_t uploadChunkSize() const noexcept
+	{
+		return chunk_columns_;
+	}
+
+	/** Set the policy used when queueing a transfer while the transfer queue is full
+	 *
+	 * All display transactions are queued in a fixed-capacity transfer queue and submitted to
+	 * the I2C master one at a time. The default policy is queue_policy::block.
+	 *
+	 * A blocked producer waits for the in-flight transfer to complete. The wait only ends early
+	 * if the wait hook gives up (see transferWaitHook()) or the wait timeout expires (see
+	 * transferWaitTimeout()). The transfer is then dropped, which is counted in the transfer
+	 * queue statistics.
+	 *
+	 * Dropped transfers are recovered: dropped frame data is sent again with the next upload,
+	 * and a dropped command causes the next upload (or wake()) to re-initialize the controller.
+	 *
+	 * @param policy The policy to apply to subsequent transfers.
+	 */
+	void transferQueuePolicy(queue_policy policy) noexcept
+	{
+		queue_policy_ = policy;
+	}
+
+	/// Get the current transfer queue policy
+	/// @returns the policy applied when the transfer queue is full.
+	queue_policy transferQueuePolicy() const noexcept
+	{
+		return queue_policy_;
+	}
+
+	/** Set the function which is called while a producer waits for a free transfer slot
+	 *
+	 * Slots are freed when transfers complete. With an interrupt-driven master, completions
+	 * arrive while we spin. Masters which complete transfers on the calling thread (polled
+	 * masters, or masters which dispatch completions from a queue) need a hook which lets
+	 * them make progress, e.g. by polling the master or yielding to the dispatch thread.
+	 *
+	 * @param wait Called repeatedly while waiting. Return false to stop waiting and drop the
+	 *	transfer. Pass nullptr to remove the hook.
+	 * @param ctx Context pointer passed to the hook.
+	 */
+	void transferWaitHook(transfer_wait_fn_t wait, void* ctx = nullptr) noexcept
+	{
+		wait_fn_ = wait;
+		wait_ctx_ = ctx;
+	}
+
+	/** Bound the time a blocked producer waits for a free transfer slot
+	 *
+	 * Without a timeout, a blocked producer waits until a slot is freed or the wait hook gives
+	 * up, so a master which stops completing transfers blocks the producer indefinitely.
+	 *
+	 * @param clock Returns a monotonic time in milliseconds. Pass nullptr to remove the timeout.
+	 * @param timeout_ms The time after which the transfer is dropped.
+	 */
+	void transferWaitTimeout(clock_ms_fn_t clock, uint32_t timeout_ms) noexcept
+	{
+		wait_clock_ = clock;
+		wait_timeout_ms_ = timeout_ms;
+	}
+
+	/** Set a function which is called before each transfer is submitted to the I2C master
+	 *
+	 * This allows every transfer of the display to be routed, e.g. by selecting the channel of
+	 * an I2C mux. The hook may be called from the I2C completion context. The route must be
+	 * in place (or the transfers which select it queued on the master) when it returns.
+	 *
+	 * If the route is not available (e.g., the mux is held by another device which still has
+	 * transfers on the bus), the hook returns false. The transfer stays queued until
+	 * resumeTransfers() is called.
+	 *
+	 * @param hook The function to call, or nullptr to remove the hook.
+	 * @param ctx Context pointer passed to the hooks.
+	 * @param idle Optional function which is called when the last queued transfer has completed,
+	 *	before another transfer can be submitted, so the route can be released.
+	 */
+	void submitHook(submit_fn_t hook, void* ctx = nullptr, idle_fn_t idle = nullptr) noexcept
+	{
+		submit_fn_ = hook;
+		submit_ctx_ = ctx;
+		idle_fn_ = idle;
+	}
+
+	/// Submit transfers held by the submit hook. Safe to call from the I2C completion context.
+	void resumeTransfers() noexcept
+	{
+		pumpTransferQueue();
+	}
+
+	/// Get the number of bytes sent by the display
+	/// @returns the number of bytes in transfers which completed successfully, including
+	///	control bytes. The counter wraps around.
+	uint32_t bytesSent() const noexcept
+	{
+		return bytes_sent_.load();
+	}
+
+	/// Get the transfer queue statistics
+	/// @returns a snapshot of the transfer queue counters and high water mark.
+	transfer_queue_stats transferQueueStats() const noexcept
+	{
+		return tx_queue_.stats();
+	}
+
+	/// Reset the transfer queue statistics
+	void resetTransferQueueStats() noexcept
+	{
+		tx_queue_.resetStats();
+	}
+
+	/// Check whether a chunked frame upload, or the rows sent by displayViewport() or wake(),
+	/// are still being sent
+	/// @returns true if an upload is in progress, false otherwise.
+	bool uploadInProgress() const noexcept
+	{
+		return upload_active_.load() || rows_active_.load();
+	}
+
+	/** Defer frame uploads to an external scheduler
+	 *
+	 * When uploads are deferred, display() only marks the frame as pending. The owner of the
+	 * display (e.g., an ssd1306_manager) is responsible for calling uploadFrame() when the
+	 * bus is available.
+	 *
+	 * @param defer True to defer uploads, false to upload immediately in display().
+	 */
+	void deferUploads(bool defer) noexcept
+	{
+		defer_uploads_ = defer;
+	}
+
+	/// Check whether display() was called since the last upload started
+	/// @returns true if a frame is waiting to be uploaded.
+	bool framePending() const noexcept
+	{
+		return frame_pending_.load();
+	}
+
+	/** Upload the screen buffer to the display
+	 *
+	 * The frame is sent as a single transfer or in chunks, depending on the upload chunk size.
+	 *
+	 * @param done Optional callback which is invoked once the final transfer of the frame
+	 *	completes. It may be invoked from the I2C completion context. If a chunked upload is
+	 *	in progress, the callback waits for the restarted upload which includes this frame,
+	 *	along with the callbacks of any other uploads requested in the meantime. If more than
+	 *	FRAME_CALLBACK_SLOTS callbacks are waiting, it is invoked immediately with
+	 *	embvm::i2c::status::busy (the frame is still uploaded).
+	 */
+	void uploadFrame(const embvm::i2c::master::cb_t& done) noexcept;
+
+	/// The number of uploadFrame() callbacks which can wait for a chunked upload
+	static constexpr size_t FRAME_CALLBACK_SLOTS = 4;
+
+	/// Get the number of bytes sent on the bus for a full frame upload
+	/// Chunked uploads skip unmodified columns, so this is an upper bound in chunked mode.
+	/// @returns the number of bytes written for a frame with the current chunk size.
+	uint16_t frameTransferSize() const noexcept;
+
+	/** Limit the rate of frame uploads
+	 *
+	 * When a limit is set, display() only marks the frame as pending, and the upload happens in
+	 * tick() once at least 1/max_fps seconds have elapsed since the previous upload. The first
+	 * upload after start() or wake() is not held back. If the screen buffer was not modified,
+	 * or its contents hash to the same value as the last uploaded frame, the upload is skipped
+	 * entirely.
+	 *
+	 * Governed displays should not also be registered with an ssd1306_manager.
+	 *
+	 * @param max_fps The maximum number of uploads per second. 0 disables the governor, and
+	 *	display() uploads immediately.
+	 */
+	void frameRateLimit(uint8_t max_fps) noexcept
+	{
+		max_fps_ = max_fps;
+	}
+
+	/// Get the frame rate limit
+	/// @returns the maximum number of uploads per second, or 0 if the governor is disabled.
+	uint8_t frameRateLimit() const noexcept
+	{
+		return max_fps_;
+	}
+
+	/** Direct drawing operations to a canvas
+	 *
+	 * All drawing primitives (including clear() and drawBitmap()) operate on the target canvas
+	 * until targetScreen() is called. Drawing to a canvas does not affect the screen buffer.
+	 *
+	 * @param c The canvas to draw on. It must remain valid while it is the target.
+	 */
+	void target(canvas& c) noexcept
+	{
+		target_ = &c;
+	}
+
+	/// Direct drawing operations to the screen buffer (the default target)
+	void targetScreen() noexcept
+	{
+		target_ = &screen_;
+	}
+
+	/** Invert the pixels in a rectangle of the target canvas
+	 *
+	 * This and the other region operations work directly on the page-organized buffer, several
+	 * columns at a time, so they are much cheaper than redrawing the region pixel by pixel.
+	 * Rectangles are clipped to the target canvas.
+	 */
+	void invertRegion(coord_t x, coord_t y, uint8_t width, uint8_t height) noexcept;
+
+	/// Copy a rectangle of the target canvas to another position
+	/// Overlapping source and destination rectangles are handled correctly.
+	/// @param dst_x The left column of the destination.
+	/// @param dst_y The top row of the destination.
+	void copyRegion(coord_t x, coord_t y, uint8_t width, uint8_t height, coord_t dst_x,
+					coord_t dst_y) noexcept;
+
+	/// Move a rectangle of the target canvas to another position
+	/// The part of the source which is not covered by the destination is filled with `fill`.
+	/// @param dst_x The left column of the destination.
+	/// @param dst_y The top row of the destination.
+	/// @param fill The color of the uncovered pixels.
+	void moveRegion(coord_t x, coord_t y, uint8_t width, uint8_t height, coord_t dst_x,
+					coord_t dst_y, color fill = color::black) noexcept;
+
+	/** Scroll the contents of a rectangle of the target canvas
+	 *
+	 * Content scrolled past the edges of the rectangle is discarded, and the vacated pixels are
+	 * filled with `fill`. Unlike the hardware scroll commands, this only changes the buffer: the
+	 * result is shown on the next display(), and only the rectangle is uploaded in chunked mode.
+	 *
+	 * @param dx The number of columns to scroll by. Positive values scroll right.
+	 * @param dy The number of rows to scroll by. Positive values scroll down.
+	 * @param fill The color of the vacated pixels.
+	 */
+	void scrollRegion(coord_t x, coord_t y, uint8_t width, uint8_t height, int8_t dx, int8_t dy,
+					  color fill = color::black) noexcept;
+
+	/** Display a window of a canvas
+	 *
+	 * The visible region is streamed from the canvas to the controller, one page at a time,
+	 * without copying it into the screen buffer. Each page row is copied into a small bounce
+	 * buffer behind its own window commands when the previous row has been sent, so the canvas
+	 * must not be modified until uploadInProgress() returns false. Vertical offsets which are
+	 * not a multiple of 8 are handled by uploading an additional page and adjusting the display
+	 * start line, so panning never requires re-rasterizing the canvas.
+	 *
+	 * The next display() restores the start line and uploads the whole screen buffer.
+	 * This must not be called while a chunked upload is in progress.
+	 *
+	 * @param c The canvas to display. It must be at least as large as the screen.
+	 * @param x The canvas column shown at the left edge of the screen.
+	 * @param y The canvas row shown at the top edge of the screen.
+	 */
+	void displayViewport(const canvas& c, coord_t x, coord_t y) noexcept;
+
+	/** Switch the controller to column streaming
+	 *
+	 * Column streaming uses vertical addressing mode, so each write of SCREEN_PAGES bytes fills
+	 * one full-height column of the display. Combined with scrollColumnsLeft(), this allows a
+	 * display to be advanced by one column for a handful of bytes on the bus.
+	 *
+	 * The stream window initially covers the rightmost column. While streaming, the screen
+	 * buffer is not shown: display() must not be called until endColumnStream().
+	 * This must not be called while a chunked upload is in progress.
+	 */
+	void beginColumnStream() noexcept;
+
+	/// Set the range of columns which are filled by streamed columns
+	/// @param first The first column of the window.
+	/// @param last The last column of the window (inclusive). The address wraps back to the
+	///		first column after the last column is written.
+	void columnStreamWindow(coord_t first, coord_t last) noexcept;
+
+	/// Write one column of pixels in column streaming mode
+	/// @param column SCREEN_PAGES bytes, from the top page to the bottom page.
+	void streamColumn(const uint8_t* column) noexcept;
+
+	/** Write a whole screen of pixels in column streaming mode
+	 *
+	 * Each page is sent as one row transaction, like displayViewport(), instead of one
+	 * transaction per column. The canvas must not be modified until uploadInProgress() returns
+	 * false. Afterwards, the stream window covers the rightmost column again.
+	 *
+	 * @param c The canvas to write. It must be at least as large as the screen.
+	 */
+	void streamCanvas(const canvas& c) noexcept;
+
+	/** Shift the controller memory one column to the left
+	 *
+	 * Uses the SSD1306 content scroll command. The controller needs one frame period to
+	 * complete each shift, so shifts should not be issued faster than the panel frame rate.
+	 */
+	void scrollColumnsLeft() noexcept;
+
+	/// Restore horizontal addressing after column streaming.
+	/// The next display() uploads the whole screen buffer.
+	void endColumnStream() noexcept;
+
+#if SSD1306_ENABLE_STATS
+	/// Get the runtime statistics
+	/// Only available when built with the `enable-ssd1306-stats` option.
+	/// @returns a snapshot of the transaction counters, queue occupancy, and operation timing.
+	ssd1306_stats stats() const noexcept;
+
+	/// Reset the runtime statistics, including the transfer queue statistics
+	void resetStats() noexcept;
+
+	/// Set the clock used to time operations. Timing is not recorded without a clock.
+	/// @param clock Function returning a monotonic timestamp; the unit is up to the caller.
+	void statsClock(ssd1306_stats_clock_t clock) noexcept
+	{
+		stats_.clock(clock);
+	}
+#endif
+
+	/** Mirror displayed frames to a remote viewer
+	 *
+	 * Each frame upload passes the screen buffer to the mirror, which sends the changes since
+	 * the previously mirrored frame to its sink. This includes uploads started by tick(),
+	 * wake(), an ssd1306_manager, or an animation_sequencer, so the viewer sees the frames which
+	 * reach the panel. Encoding happens when the upload is started, in thread context, so the
+	 * sink should not block for long.
+	 *
+	 * Only the screen buffer is mirrored. Content sent with displayViewport() or column
+	 * streaming (e.g., by strip_chart) bypasses the screen buffer, so the viewer keeps showing
+	 * the last uploaded frame until the next upload.
+	 *
+	 * @param m The mirror to update, or nullptr to stop mirroring. It must match the screen
+	 *	dimensions and remain valid while it is set.
+	 */
+	void mirror(frame_mirror* m) noexcept
+	{
+		mirror_ = m;
+	}
+
+	/** Switch the panel off to save power
+	 *
+	 * The controller retains its configuration and GDRAM while the panel is off. Calls to
+	 * display() while the panel is asleep do not upload anything: the accumulated changes are
+	 * sent by wake(). stop() puts the panel to sleep.
+	 */
+	void sleep() noexcept;
+
+	/** Switch the panel back on
+	 *
+	 * If the controller state is still valid, this sends only the columns changed by display()
+	 * calls made while asleep, followed by DISPLAY_ON. Otherwise (on the first start, after a
+	 * failed transfer or a dropped command, or after invalidateController()), the full
+	 * initialization sequence is sent, followed by the whole screen buffer. start() wakes the
+	 * panel.
+	 *
+	 * Displays with deferred uploads or a frame rate limit leave the changes pending for their
+	 * scheduler, so the panel briefly shows the frame it had when it was put to sleep.
+	 */
+	void wake() noexcept;
+
+	/// Check whether the panel is asleep
+	bool asleep() const noexcept
+	{
+		return asleep_;
+	}
+
+	/// Mark the controller state as lost, so the next wake() or frame upload re-initializes the
+	/// controller
+	/// Use this after power-cycling or resetting the panel. Settings changed after start
+	/// (contrast, inversion, and flips) are sent again by the initialization sequence.
+	void invalidateController() noexcept
+	{
+		controller_valid_ = false;
+	}
+
+	/// Drive the frame rate governor
+	/// Call this periodically (e.g., from a timer or the main loop) when a limit is set.
+	/// @param now_ms The current time in milliseconds.
+	void tick(uint32_t now_ms) noexcept;
+
 	// TODO: refactor font functions out of this driver
 
 	/// Set the font type
@@ -117,12 +572,107 @@ class ssd1306 final : public embvm::basicDisplay
 	void start_() noexcept final;
 	void stop_() noexcept final;
 
+	/// The number of transfers which can be queued at one time
+	static constexpr size_t TRANSFER_QUEUE_DEPTH = 16;
+
+	/// The number of bytes which can be stored inside of a queued transfer.
+	/// This is large enough to coalesce a full scroll setup sequence.
+	static constexpr size_t TRANSFER_PAYLOAD_SIZE = 16;
+
+	using transfer_queue_t = transfer_queue<TRANSFER_QUEUE_DEPTH, TRANSFER_PAYLOAD_SIZE>;
+
 	/// Helper function which performs an I2C write
+	/// @param op The I2C write operation to perform.
 	/// @param buffer The transaction buffer.
 	/// @param size The size of the write.
 	/// @param cb The callback function to invoke when the write completes.
-	void i2c_write(const uint8_t* buffer, uint8_t size,
-				   const embvm::i2c::master::cb_t& cb) noexcept;
+	/// @returns the status returned by the I2C master.
+	embvm::i2c::status i2c_write(embvm::i2c::operation op, const uint8_t* buffer, uint16_t size,
+								 const embvm::i2c::master::cb_t& cb) noexcept;
+
+	/// Reserve transfer descriptors, applying the queue policy if the queue is full
+	/// @param policy The policy to apply if the queue is full.
+	/// @param count The number of consecutive descriptors to reserve.
+	/// @returns the first descriptor to fill and publish, or nullptr if the transfer was dropped.
+	transfer_queue_t::descriptor* reserveTransfer(queue_policy policy, size_t count = 1) noexcept;
+
+	/// Make progress on the in-flight transfer while waiting for a free slot
+	/// @param start_ms The value returned by waitStart() when the wait started.
+	/// @returns false if the caller should stop waiting.
+	bool waitForTransfer(uint32_t start_ms) noexcept;
+
+	/// @returns the start time of a wait for waitForTransfer()
+	uint32_t waitStart() const noexcept
+	{
+		return wait_clock_ ? wait_clock_() : 0;
+	}
+
+	/// Queue a transfer which is copied into the transfer queue
+	/// @param control The control byte (command or data) which leads the transfer.
+	/// @param bytes The bytes to send after the control byte.
+	/// @param count The number of bytes to send after the control byte.
+	void queueBytes(uint8_t control, const uint8_t* bytes, uint8_t count) noexcept;
+
+	/// Queue a transfer which references an external buffer
+	/// @param buffer The transaction buffer. Must remain valid until the transfer completes.
+	/// @param size The size of the write.
+	/// @param cb The callback function to invoke when the write completes.
+	/// @param policy The policy to apply if the queue is full.
+	/// @returns true if the transfer was queued, false if it was dropped.
+	bool queueBuffer(const uint8_t* buffer, uint16_t size, const embvm::i2c::master::cb_t& cb,
+					 queue_policy policy) noexcept;
+
+	/** Start collecting rows for queueRows()
+	 *
+	 * Waits for the rows of the previous call to be staged, like a blocked producer.
+	 *
+	 * @returns false if the wait gave up. The rows are dropped and GDRAM is marked stale.
+	 */
+	bool beginRows() noexcept;
+
+	/// Add a page row to send with queueRows()
+	/// @param page The GDRAM page to write.
+	/// @param column The first screen column to write.
+	/// @param data The row contents. Must remain valid until the row is sent.
+	/// @param count The number of columns to write.
+	void addRow(uint8_t page, uint8_t column, const uint8_t* data, uint8_t count) noexcept
+	{
+		assert(row_count_ < MAX_STAGED_ROWS);
+		rows_[row_count_++] = {data, page, column, count};
+	}
+
+	/** Queue the rows added since beginRows()
+	 *
+	 * Each row is sent as a single, complete transaction: it is copied into row_buffer_ behind
+	 * its own window commands once the previous row has been sent. A control byte must never
+	 * be sent in a separate transfer from its data, since other clients of the I2C master may
+	 * start a transaction in between. The transfers for all rows are reserved up front, so
+	 * anything queued after this call is sent after the rows.
+	 */
+	void queueRows() noexcept;
+
+	/// Copy the next row into row_buffer_ and publish its transfer, or finish the rows.
+	/// This is called from the I2C completion callback of the previous row.
+	void stageNextRow() noexcept;
+
+	/// Write the window commands and data control byte which lead a row of `columns` bytes
+	/// @param buffer Receives CHUNK_HEADER_SIZE bytes.
+	/// @param page The GDRAM page to write.
+	/// @param column The first screen column to write.
+	/// @param columns The number of columns to write.
+	void writeWindowHeader(uint8_t* buffer, uint8_t page, uint8_t column,
+						   uint8_t columns) noexcept;
+
+	/// Submit queued transfers until one is in flight or the queue is empty
+	/// This may be called from thread and completion contexts, and from inside a completion.
+	void pumpTransferQueue() noexcept;
+
+	/// Submit the next queued transfer if no transfer is in flight (see pumpTransferQueue())
+	void submitTransfer() noexcept;
+
+	/// Release the in-flight transfer and submit the next one.
+	/// This is called from the I2C completion callback.
+	void transferComplete(embvm::i2c::op_t op, embvm::i2c::status status) noexcept;
 
 	// RAW LCD functions
 
@@ -149,6 +699,18 @@ class ssd1306 final : public embvm::basicDisplay
 	/// @param c The data byte to send to the display.
 	void data(uint8_t c) noexcept;
 
+	/// Set the column and page window which receives data bytes
+	/// @param first_column The first screen column of the window.
+	/// @param last_column The last screen column of the window (inclusive).
+	/// @param first_page The first page of the window.
+	/// @param last_page The last page of the window (inclusive).
+	void setWindow(uint8_t first_column, uint8_t last_column, uint8_t first_page,
+				   uint8_t last_page) noexcept;
+
+	/// Set the full-screen window, which single-transfer uploads of the screen buffer expect
+	/// Anything which leaves a partial window set must restore it.
+	void restoreFullWindow() noexcept;
+
 	/// Set the column address
 	/// @param add The address of the column.
 	void setColumnAddress(uint8_t add) noexcept;
@@ -157,6 +719,91 @@ class ssd1306 final : public embvm::basicDisplay
 	/// @param add The address of the page.
 	void setPageAddress(uint8_t add) noexcept;
 
+	/// Send the controller initialization sequence, leaving the panel off
+	void initController() noexcept;
+
+	/// Upload the modified columns of each page as individual windows, then restore the
+	/// full-screen window. Uses a chunked upload if chunking is enabled.
+	void uploadDirtyWindows() noexcept;
+
+	/// Begin a chunked upload of the screen buffer, starting with the first page.
+	/// @param policy The policy to apply if the transfer queue is full.
+	void startChunkedUpload(queue_policy policy) noexcept;
+
+	/// Mark columns of a page as modified since the last upload
+	/// @param page The page containing the modified columns.
+	/// @param first The first modified column.
+	/// @param last The last modified column (inclusive).
+	void markDirty(uint8_t page, uint8_t first, uint8_t last) noexcept
+	{
+		dirty_first_[page] = std::min(dirty_first_[page], first);
+		dirty_last_[page] = std::max(dirty_last_[page], last);
+	}
+
+	/// Plot points with a resolved drawing operation
+	/// @param unpack Converts an element of `points` to a point.
+	/// @param op Applies a pixel mask to a buffer byte.
+	template<typename TPoints, typename TUnpack, typename TOp>
+	void plotPoints(const TPoints& points, const TUnpack& unpack, const TOp& op) noexcept;
+
+	/// Plot points, resolving the drawing operation from the color and mode
+	template<typename TPoints, typename TUnpack>
+	void plotPoints(const TPoints& points, const TUnpack& unpack, color c, mode m) noexcept;
+
+	/// Mark a rectangle as modified if the target is the screen buffer
+	/// The rectangle is clipped to the screen.
+	void markRegionDirty(int16_t x, int16_t y, int16_t width, int16_t height) noexcept;
+
+	/// Mark the whole screen buffer as modified since the last upload
+	void markAllDirty() noexcept
+	{
+		dirty_first_.fill(0);
+		dirty_last_.fill(SCREEN_WIDTH - 1);
+	}
+
+	/// Mark the whole screen buffer as matching the display contents
+	void clearDirty() noexcept
+	{
+		dirty_first_.fill(SCREEN_WIDTH);
+		dirty_last_.fill(0);
+	}
+
+	/// Check whether the screen buffer was modified since the last upload
+	bool isDirty() const noexcept;
+
+	/// Record that GDRAM may not match the screen buffer after a failed or dropped transfer
+	/// This is safe to call from the completion context.
+	void markGdramStale() noexcept;
+
+	/// Mark the whole screen as dirty if GDRAM was marked stale (thread context only)
+	void reclaimStaleGdram() noexcept;
+
+	/// Re-initialize the controller if a command was lost while the panel is on, so the next
+	/// upload sends the whole frame to a known configuration (thread context only)
+	void reclaimController() noexcept;
+
+	/// Compute a hash of the screen buffer contents
+	uint32_t frameHash() const noexcept;
+
+	/// Register a callback to notify when a chunked upload which includes the current frame
+	/// completes
+	/// @returns false if all callback slots are in use.
+	bool addFrameCallback(const embvm::i2c::master::cb_t& cb) noexcept;
+
+	/// Complete a chunked upload, notify the frame callbacks which were registered before it
+	/// started, and restart the upload if another frame was requested.
+	/// @param status The status to report to the frame callbacks.
+	void finishChunkedUpload(embvm::i2c::status status) noexcept;
+
+	/// @returns the operation reported to frame callbacks
+	embvm::i2c::op_t frameOp() const noexcept;
+
+	/// Send the next chunk of a chunked upload, or finish the upload if the frame is complete.
+	/// This is called from the I2C completion callback of the previous chunk.
+	/// @param policy The policy to apply if the transfer queue is full. If the chunk is
+	///		dropped or fails, the upload is abandoned and the next upload sends the whole frame.
+	void sendNextChunk(queue_policy policy) noexcept;
+
 	void drawCharSingleRow(coord_t x, coord_t y, uint8_t character, color c, mode m) noexcept;
 	void drawCharMultiRow(coord_t x, coord_t y, uint8_t character, color c, mode m) noexcept;
 
@@ -173,19 +820,39 @@ class ssd1306 final : public embvm::basicDisplay
 	ssd1306& operator=(ssd1306&&) = delete;
 
   private:
-	/// The width of the scren in pixels
-	static constexpr uint8_t SCREEN_WIDTH = 64;
-
-	/// The height of the screen in pixels
-	static constexpr uint8_t SCREEN_HEIGHT = 48;
-
 	/// The size of the screen buffer
 	/// We divide by 8 because each byte controls the state of 8 pixels.
 	static constexpr size_t SCREEN_BUFFER_SIZE = ((SCREEN_WIDTH * SCREEN_HEIGHT) / 8);
 
+	using page_columns_t = std::array<uint8_t, SCREEN_PAGES>;
+
 	/// The number of columns offset into the display where the active display area starts.
 	static constexpr uint8_t COLUMN_OFFSET = 32;
 
+	/// The contrast sent by the initialization sequence until contrast() is called.
+	static constexpr uint8_t DEFAULT_CONTRAST = 0x8F;
+
+	/// The size of the header which precedes the data in each chunk of a chunked upload, and
+	/// in each staged row. The header contains the column and page window commands, each byte
+	/// prefixed with a control byte, followed by the data control byte.
+	static constexpr uint8_t CHUNK_HEADER_SIZE = 13;
+
+	/// The maximum number of rows sent by queueRows(). A viewport with a start line offset
+	/// spans one page more than the screen.
+	static constexpr uint8_t MAX_STAGED_ROWS = SCREEN_PAGES + 1;
+
+	/// A page row which is copied into row_buffer_ when it is sent
+	struct staged_row
+	{
+		const uint8_t* data;
+		/// The GDRAM page to write
+		uint8_t page;
+		/// The first screen column to write
+		uint8_t column;
+		/// The number of columns to write
+		uint8_t count;
+	};
+
 	uint8_t fontWidth_ = 0, fontHeight_ = 0, fontType_ = 0, fontStartChar_ = 0, fontTotalChar_ = 0;
 	uint16_t fontMapWidth_ = 0;
 
@@ -204,8 +871,44 @@ class ssd1306 final : public embvm::basicDisplay
 	/// Array of fonts supported by this driver
 	static const std::array<const uint8_t*, 2> fonts_;
 
-	/// Static memory pool which is used for display I2C transactions.
-	etl::variant_pool<128, uint8_t, uint16_t, uint32_t> i2c_pool_{};
+	/// Queue of pending display I2C transactions.
+	transfer_queue_t tx_queue_{};
+
+	/// The policy applied when the transfer queue is full.
+	queue_policy queue_policy_ = queue_policy::block;
+
+	/// Indicates that a queued transfer has been submitted to the I2C master.
+	std::atomic<bool> transfer_active_{false};
+
+	/// Indicates that pumpTransferQueue() is running its submit loop.
+	std::atomic<bool> pumping_{false};
+
+	/// Indicates that the submit loop must run again, e.g. because a transfer completed.
+	std::atomic<bool> pump_requested_{false};
+
+	/// Called while a producer waits for a free transfer slot, if set.
+	transfer_wait_fn_t wait_fn_ = nullptr;
+
+	/// Context pointer passed to wait_fn_.
+	void* wait_ctx_ = nullptr;
+
+	/// Clock for the wait timeout. Blocked producers wait indefinitely if this is not set.
+	clock_ms_fn_t wait_clock_ = nullptr;
+
+	/// The time after which a blocked producer drops its transfer.
+	uint32_t wait_timeout_ms_ = 0;
+
+	/// Called before each transfer is submitted, if set.
+	submit_fn_t submit_fn_ = nullptr;
+
+	/// Context pointer passed to submit_fn_ and idle_fn_.
+	void* submit_ctx_ = nullptr;
+
+	/// Called when the transfer queue drains, if set.
+	idle_fn_t idle_fn_ = nullptr;
+
+	/// The number of bytes in successfully completed transfers.
+	std::atomic<uint32_t> bytes_sent_{0};
 
 	/** \brief OLED screen buffer.
 	 * Page buffer is required because in SPI and I2C mode, the host cannot read the SSD1306's GDRAM
@@ -221,6 +924,133 @@ class ssd1306 final : public embvm::basicDisplay
 	/// Pointer alias to the display_buffer_ which accounts for the single byte reserved for the
 	/// DATA command value.
 	uint8_t* const screen_buffer_ = &display_buffer_[1];
+
+	/// Canvas view of the screen buffer.
+	canvas screen_{screen_buffer_, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+	/// The canvas which drawing operations are applied to.
+	canvas* target_ = &screen_;
+
+	/// Receives each displayed frame, if set.
+	frame_mirror* mirror_ = nullptr;
+
+	/// Indicates that the initialization sequence has been sent at least once.
+	bool initialized_ = false;
+
+	/// Indicates that the controller configuration is known to match the initialization
+	/// sequence. Cleared from the completion context if a transfer fails.
+	std::atomic<bool> controller_valid_{false};
+
+	/// Indicates that the panel was switched off with sleep().
+	bool asleep_ = false;
+
+	/// The display start line set by displayViewport().
+	uint8_t start_line_ = 0;
+
+	/// Settings which are replayed by the initialization sequence, so a re-initialized
+	/// controller keeps the configuration set by the user.
+	uint8_t contrast_ = DEFAULT_CONTRAST;
+	bool inverted_ = false;
+	bool flip_vertical_ = false;
+	bool flip_horizontal_ = false;
+
+	/// Indicates that the controller is in column streaming mode.
+	bool column_stream_ = false;
+
+	/// The number of columns sent in each chunk. 0 indicates that chunking is disabled.
+	uint8_t chunk_columns_ = 0;
+
+	/// The page of the chunk currently being sent.
+	uint8_t chunk_page_ = 0;
+
+	/// The starting column of the chunk currently being sent.
+	uint8_t chunk_column_ = 0;
+
+	/// Indicates that a chunked upload is in progress.
+	std::atomic<bool> upload_active_{false};
+
+	/// Indicates that display() was called and the frame needs to be uploaded (again).
+	std::atomic<bool> upload_requested_{false};
+
+	/// Callbacks waiting for a chunked upload to complete, in registration order.
+	std::array<embvm::i2c::master::cb_t, FRAME_CALLBACK_SLOTS> frame_cbs_{};
+
+	/// Index of the next frame callback to notify. Only advanced by finishChunkedUpload().
+	std::atomic<size_t> frame_cb_head_{0};
+
+	/// Index of the next free frame callback slot. Only advanced by uploadFrame().
+	std::atomic<size_t> frame_cb_tail_{0};
+
+	/// frame_cb_tail_ when the current upload started. The callbacks before it are notified
+	/// when the upload completes.
+	size_t frame_cb_end_ = 0;
+
+	/// Indicates that display() only marks the frame as pending.
+	bool defer_uploads_ = false;
+
+	/// Indicates that display() was called while uploads were deferred.
+	std::atomic<bool> frame_pending_{false};
+
+	/// The first modified column in each page. A page is clean if first > last.
+	page_columns_t dirty_first_{};
+
+	/// The last modified column in each page.
+	page_columns_t dirty_last_{};
+
+	/// The first column in each page which must be sent by the current chunked upload.
+	/// Ranges are only widened while an upload is in progress.
+	page_columns_t upload_first_{};
+
+	/// The last column in each page which must be sent by the current chunked upload.
+	page_columns_t upload_last_{};
+
+#if SSD1306_ENABLE_STATS
+	/// Runtime statistics
+	ssd1306_stats_collector stats_{};
+#endif
+
+	/// The frame rate limit. 0 indicates that the governor is disabled.
+	uint8_t max_fps_ = 0;
+
+	/// The time of the last governed upload in milliseconds.
+	uint32_t last_upload_ms_ = 0;
+
+	/// Set until the first governed upload after start or wake, which is due immediately.
+	bool first_upload_ = true;
+
+	/// The hash of the last governed upload.
+	uint32_t last_frame_hash_ = 0;
+
+	/// Indicates that the controller contains the frame described by last_frame_hash_.
+	/// Cleared from the completion context if a transfer fails.
+	std::atomic<bool> frame_hash_valid_{false};
+
+	/// Indicates that a transfer failed or was dropped, so GDRAM may not match the screen
+	/// buffer. Set from the completion context, and turned into a fully dirty screen by the
+	/// next upload.
+	std::atomic<bool> gdram_stale_{false};
+
+	/// Transaction buffer for chunked uploads: window commands followed by the chunk data.
+	uint8_t chunk_buffer_[CHUNK_HEADER_SIZE + SCREEN_WIDTH] = {0};
+
+	/// The rows collected for queueRows().
+	std::array<staged_row, MAX_STAGED_ROWS> rows_{};
+
+	/// The number of entries in rows_.
+	uint8_t row_count_ = 0;
+
+	/// The next row to stage.
+	uint8_t row_next_ = 0;
+
+	/// The reserved transfer for the next row to stage.
+	transfer_queue_t::descriptor* row_descriptor_ = nullptr;
+
+	/// Indicates that rows_ is in use. Cleared from the completion context once the last row
+	/// has been staged.
+	std::atomic<bool> rows_active_{false};
+
+	/// Transaction buffer for staged rows: window commands followed by the row data.
+	uint8_t row_buffer_[CHUNK_HEADER_SIZE + SCREEN_WIDTH] = {0};
 };
 
 } // namespace embdrv
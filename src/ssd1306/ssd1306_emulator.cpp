@@ -0,0 +1,550 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#include "ssd1306_emulator.hpp"
+#include <cassert>
+#include <cstring>
+
+using namespace embdrv;
+
+namespace
+{
+constexpr uint8_t CONTROL_CONTINUATION = UINT8_C(0x80);
+constexpr uint8_t CONTROL_DATA = UINT8_C(0x40);
+
+constexpr uint8_t SET_LOWER_COLUMN = UINT8_C(0x00);
+constexpr uint8_t SET_HIGHER_COLUMN = UINT8_C(0x10);
+constexpr uint8_t SET_ADDRESSING_MODE = UINT8_C(0x20);
+constexpr uint8_t SET_COLUMN_ADDRESS = UINT8_C(0x21);
+constexpr uint8_t SET_PAGE_ADDRESS = UINT8_C(0x22);
+constexpr uint8_t RIGHT_HORIZONTAL_SCROLL = UINT8_C(0x26);
+constexpr uint8_t LEFT_HORIZONTAL_SCROLL = UINT8_C(0x27);
+constexpr uint8_t VERTICAL_RIGHT_HORIZONTAL_SCROLL = UINT8_C(0x29);
+constexpr uint8_t VERTICAL_LEFT_HORIZONTAL_SCROLL = UINT8_C(0x2A);
+constexpr uint8_t CONTENT_SCROLL_RIGHT = UINT8_C(0x2C);
+constexpr uint8_t CONTENT_SCROLL_LEFT = UINT8_C(0x2D);
+constexpr uint8_t DEACTIVATE_SCROLL = UINT8_C(0x2E);
+constexpr uint8_t ACTIVATE_SCROLL = UINT8_C(0x2F);
+constexpr uint8_t SET_START_LINE = UINT8_C(0x40);
+constexpr uint8_t SET_CONTRAST = UINT8_C(0x81);
+constexpr uint8_t CHARGE_PUMP = UINT8_C(0x8D);
+constexpr uint8_t SEG_REMAP = UINT8_C(0xA0);
+constexpr uint8_t SET_VERTICAL_SCROLL_AREA = UINT8_C(0xA3);
+constexpr uint8_t DISPLAY_ALL_ON_RESUME = UINT8_C(0xA4);
+constexpr uint8_t DISPLAY_ALL_ON = UINT8_C(0xA5);
+constexpr uint8_t NORMAL_DISPLAY = UINT8_C(0xA6);
+constexpr uint8_t INVERT_DISPLAY = UINT8_C(0xA7);
+constexpr uint8_t SET_MULTIPLEX = UINT8_C(0xA8);
+constexpr uint8_t DISPLAY_OFF = UINT8_C(0xAE);
+constexpr uint8_t DISPLAY_ON = UINT8_C(0xAF);
+constexpr uint8_t SET_PAGE_START = UINT8_C(0xB0);
+constexpr uint8_t COM_SCAN_INC = UINT8_C(0xC0);
+constexpr uint8_t COM_SCAN_DEC = UINT8_C(0xC8);
+constexpr uint8_t SET_DISPLAY_OFFSET = UINT8_C(0xD3);
+constexpr uint8_t SET_DISPLAY_CLOCK_DIV = UINT8_C(0xD5);
+constexpr uint8_t SET_PRECHARGE = UINT8_C(0xD9);
+constexpr uint8_t SET_COMP_INS = UINT8_C(0xDA);
+constexpr uint8_t SET_VCOM_DESELECT = UINT8_C(0xDB);
+constexpr uint8_t NOP = UINT8_C(0xE3);
+
+constexpr uint8_t CHARGE_PUMP_ENABLE = UINT8_C(0x04);
+constexpr uint8_t MIN_MULTIPLEX = UINT8_C(16);
+
+/// @returns the number of argument bytes which follow a command
+uint8_t argumentCount(uint8_t cmd) noexcept
+{
+	switch(cmd)
+	{
+		case SET_ADDRESSING_MODE:
+		case SET_CONTRAST:
+		case CHARGE_PUMP:
+		case SET_MULTIPLEX:
+		case SET_DISPLAY_OFFSET:
+		case SET_DISPLAY_CLOCK_DIV:
+		case SET_PRECHARGE:
+		case SET_COMP_INS:
+		case SET_VCOM_DESELECT:
+			return 1;
+		case SET_COLUMN_ADDRESS:
+		case SET_PAGE_ADDRESS:
+		case SET_VERTICAL_SCROLL_AREA:
+			return 2;
+		case VERTICAL_RIGHT_HORIZONTAL_SCROLL:
+		case VERTICAL_LEFT_HORIZONTAL_SCROLL:
+			return 5;
+		case RIGHT_HORIZONTAL_SCROLL:
+		case LEFT_HORIZONTAL_SCROLL:
+			return 6;
+		case CONTENT_SCROLL_RIGHT:
+		case CONTENT_SCROLL_LEFT:
+			return 7;
+		default:
+			return 0;
+	}
+}
+
+} // namespace
+
+ssd1306_emulator::ssd1306_emulator(uint8_t address, ssd1306_panel panel) noexcept
+	: embvm::i2c::master("ssd1306 emulator"), address_(address), panel_(panel)
+{
+	assert(panel.column_offset + panel.width <= GDRAM_COLUMNS);
+	assert(panel.height <= GDRAM_ROWS);
+}
+
+void ssd1306_emulator::reset() noexcept
+{
+	in_transaction_ = false;
+	rx_ = rx_state::control;
+	cmd_size_ = 0;
+	cmd_expected_ = 0;
+
+	display_on_ = false;
+	inverted_ = false;
+	entire_on_ = false;
+	charge_pump_ = false;
+	seg_remap_ = false;
+	com_remap_ = false;
+	contrast_ = 0x7F; // NOLINT
+	mux_ = GDRAM_ROWS;
+	offset_ = 0;
+	start_line_ = 0;
+	mode_ = addressing::page;
+	column_start_ = 0;
+	column_end_ = GDRAM_COLUMNS - 1;
+	page_start_ = 0;
+	page_end_ = GDRAM_PAGES - 1;
+	page_mode_column_ = 0;
+	column_ = 0;
+	page_ = 0;
+	scroll_active_ = false;
+}
+
+embvm::i2c::status ssd1306_emulator::transfer_(const embvm::i2c::op_t& op,
+											   const embvm::i2c::master::cb_t& cb) noexcept
+{
+	pending_.push_back({op, cb});
+
+	if(manual_)
+	{
+		return embvm::i2c::status::enqueued;
+	}
+
+	// Transfers submitted from a completion callback are completed once the callback returns,
+	// rather than recursively
+	if(!completing_)
+	{
+		completing_ = true;
+		completeAll();
+		completing_ = false;
+	}
+
+	return embvm::i2c::status::ok;
+}
+
+bool ssd1306_emulator::completeNext(embvm::i2c::status status) noexcept
+{
+	if(pending_.empty())
+	{
+		return false;
+	}
+
+	const auto t = pending_.front();
+	pending_.pop_front();
+	complete(t, status);
+
+	return true;
+}
+
+void ssd1306_emulator::completeAll() noexcept
+{
+	while(completeNext())
+	{
+	}
+}
+
+void ssd1306_emulator::complete(const transfer_t& t, embvm::i2c::status status) noexcept
+{
+	if(fail_next_ != embvm::i2c::status::ok)
+	{
+		status = fail_next_;
+		fail_next_ = embvm::i2c::status::ok;
+	}
+
+	if(status == embvm::i2c::status::ok && t.op.address != address_)
+	{
+		status = embvm::i2c::status::addrNACK;
+	}
+
+	if(status == embvm::i2c::status::ok)
+	{
+		receive(t.op);
+	}
+	else
+	{
+		// A failed transfer ends the transaction
+		in_transaction_ = false;
+	}
+
+	if(t.cb)
+	{
+		t.cb(t.op, status);
+	}
+}
+
+void ssd1306_emulator::receive(const embvm::i2c::op_t& op) noexcept
+{
+	switch(op.op)
+	{
+		case embvm::i2c::operation::write:
+		case embvm::i2c::operation::writeNoStop:
+			in_transaction_ = true;
+			rx_ = rx_state::control;
+			stats_.transactions++;
+			break;
+		case embvm::i2c::operation::continueWriteStop:
+		case embvm::i2c::operation::continueWriteNoStop:
+			if(!in_transaction_)
+			{
+				stats_.violations++;
+				in_transaction_ = true;
+				rx_ = rx_state::control;
+				stats_.transactions++;
+			}
+			break;
+		default:
+			// The controller is write-only over I2C
+			stats_.violations++;
+			return;
+	}
+
+	stats_.bytes += static_cast<uint32_t>(op.tx_size);
+	for(size_t i = 0; i < op.tx_size; i++)
+	{
+		receiveByte(op.tx_buffer[i]);
+	}
+
+	if(op.op == embvm::i2c::operation::write ||
+	   op.op == embvm::i2c::operation::continueWriteStop)
+	{
+		in_transaction_ = false;
+	}
+}
+
+void ssd1306_emulator::receiveByte(uint8_t b) noexcept
+{
+	switch(rx_)
+	{
+		case rx_state::control:
+			stats_.control_bytes++;
+			if(b & CONTROL_CONTINUATION)
+			{
+				rx_ = (b & CONTROL_DATA) ? rx_state::single_data : rx_state::single_command;
+			}
+			else
+			{
+				rx_ = (b & CONTROL_DATA) ? rx_state::data_stream : rx_state::command_stream;
+			}
+			break;
+		case rx_state::command_stream:
+			commandByte(b);
+			break;
+		case rx_state::data_stream:
+			dataByte(b);
+			break;
+		case rx_state::single_command:
+			commandByte(b);
+			rx_ = rx_state::control;
+			break;
+		case rx_state::single_data:
+			dataByte(b);
+			rx_ = rx_state::control;
+			break;
+	}
+}
+
+void ssd1306_emulator::commandByte(uint8_t b) noexcept
+{
+	stats_.command_bytes++;
+
+	// Arguments may arrive in later transactions (e.g., ssd1306::contrast())
+	if(cmd_size_ == 0)
+	{
+		cmd_expected_ = static_cast<uint8_t>(argumentCount(b) + 1);
+	}
+
+	cmd_[cmd_size_++] = b;
+
+	if(cmd_size_ == cmd_expected_)
+	{
+		execute();
+		cmd_size_ = 0;
+	}
+}
+
+void ssd1306_emulator::execute() noexcept
+{
+	const auto cmd = cmd_[0];
+
+	if(cmd < SET_HIGHER_COLUMN)
+	{
+		page_mode_column_ = static_cast<uint8_t>((page_mode_column_ & 0xF0) | // NOLINT
+												 (cmd - SET_LOWER_COLUMN));
+		column_ = page_mode_column_;
+		return;
+	}
+
+	if(cmd < SET_ADDRESSING_MODE)
+	{
+		page_mode_column_ = static_cast<uint8_t>((page_mode_column_ & 0x0F) | // NOLINT
+												 ((cmd - SET_HIGHER_COLUMN) << 4));
+		column_ = page_mode_column_;
+		return;
+	}
+
+	if(cmd >= SET_START_LINE && cmd < SET_START_LINE + GDRAM_ROWS)
+	{
+		start_line_ = static_cast<uint8_t>(cmd - SET_START_LINE);
+		return;
+	}
+
+	if(cmd >= SET_PAGE_START && cmd < SET_PAGE_START + GDRAM_PAGES)
+	{
+		page_ = static_cast<uint8_t>(cmd - SET_PAGE_START);
+		return;
+	}
+
+	switch(cmd)
+	{
+		case SET_ADDRESSING_MODE:
+			if(cmd_[1] > static_cast<uint8_t>(addressing::page))
+			{
+				stats_.violations++;
+				break;
+			}
+			mode_ = static_cast<addressing>(cmd_[1]);
+			break;
+		case SET_COLUMN_ADDRESS:
+			column_start_ = static_cast<uint8_t>(cmd_[1] % GDRAM_COLUMNS);
+			column_end_ = static_cast<uint8_t>(cmd_[2] % GDRAM_COLUMNS);
+			column_ = column_start_;
+			break;
+		case SET_PAGE_ADDRESS:
+			page_start_ = static_cast<uint8_t>(cmd_[1] % GDRAM_PAGES);
+			page_end_ = static_cast<uint8_t>(cmd_[2] % GDRAM_PAGES);
+			page_ = page_start_;
+			break;
+		case SET_CONTRAST:
+			contrast_ = cmd_[1];
+			break;
+		case CHARGE_PUMP:
+			charge_pump_ = (cmd_[1] & CHARGE_PUMP_ENABLE) != 0;
+			break;
+		case SET_MULTIPLEX:
+			mux_ = static_cast<uint8_t>((cmd_[1] % GDRAM_ROWS) + 1);
+			if(mux_ < MIN_MULTIPLEX)
+			{
+				stats_.violations++;
+			}
+			break;
+		case SET_DISPLAY_OFFSET:
+			offset_ = static_cast<uint8_t>(cmd_[1] % GDRAM_ROWS);
+			break;
+		case SEG_REMAP:
+		case SEG_REMAP | 0x1:
+			seg_remap_ = (cmd & 0x1) != 0;
+			break;
+		case COM_SCAN_INC:
+		case COM_SCAN_DEC:
+			com_remap_ = cmd == COM_SCAN_DEC;
+			break;
+		case DISPLAY_ALL_ON_RESUME:
+		case DISPLAY_ALL_ON:
+			entire_on_ = cmd == DISPLAY_ALL_ON;
+			break;
+		case NORMAL_DISPLAY:
+		case INVERT_DISPLAY:
+			inverted_ = cmd == INVERT_DISPLAY;
+			break;
+		case DISPLAY_OFF:
+		case DISPLAY_ON:
+			display_on_ = cmd == DISPLAY_ON;
+			break;
+		case ACTIVATE_SCROLL:
+			scroll_active_ = true;
+			break;
+		case DEACTIVATE_SCROLL:
+			scroll_active_ = false;
+			break;
+		case CONTENT_SCROLL_RIGHT:
+		case CONTENT_SCROLL_LEFT:
+			contentScroll(cmd == CONTENT_SCROLL_RIGHT);
+			break;
+		case RIGHT_HORIZONTAL_SCROLL:
+		case LEFT_HORIZONTAL_SCROLL:
+		case VERTICAL_RIGHT_HORIZONTAL_SCROLL:
+		case VERTICAL_LEFT_HORIZONTAL_SCROLL:
+		case SET_VERTICAL_SCROLL_AREA:
+		case SET_DISPLAY_CLOCK_DIV:
+		case SET_PRECHARGE:
+		case SET_COMP_INS:
+		case SET_VCOM_DESELECT:
+		case NOP:
+			// Timing and scroll setup do not affect the emulated image
+			break;
+		default:
+			stats_.violations++;
+			break;
+	}
+}
+
+void ssd1306_emulator::contentScroll(bool right) noexcept
+{
+	// The controller must not be scrolling continuously
+	if(scroll_active_)
+	{
+		stats_.violations++;
+		return;
+	}
+
+	const auto first_page = static_cast<uint8_t>(cmd_[2] % GDRAM_PAGES);
+	const auto last_page = static_cast<uint8_t>(cmd_[4] % GDRAM_PAGES);
+	const auto first_column = static_cast<uint8_t>(cmd_[6] % GDRAM_COLUMNS);
+	const auto last_column = static_cast<uint8_t>(cmd_[7] % GDRAM_COLUMNS);
+
+	if(first_page > last_page || first_column >= last_column)
+	{
+		stats_.violations++;
+		return;
+	}
+
+	content_scrolls_++;
+
+	// The column shifted out of the range re-enters at the other end
+	for(auto page = first_page; page <= last_page; page++)
+	{
+		auto* const row = gdram_[page].data();
+		if(right)
+		{
+			const auto wrapped = row[last_column];
+			memmove(&row[first_column + 1], &row[first_column], last_column - first_column);
+			row[first_column] = wrapped;
+		}
+		else
+		{
+			const auto wrapped = row[first_column];
+			memmove(&row[first_column], &row[first_column + 1], last_column - first_column);
+			row[last_column] = wrapped;
+		}
+	}
+}
+
+void ssd1306_emulator::dataByte(uint8_t b) noexcept
+{
+	stats_.data_bytes++;
+
+	// GDRAM must not be written while scrolling
+	if(scroll_active_)
+	{
+		stats_.violations++;
+	}
+
+	gdram_[page_][column_] = b;
+
+	switch(mode_)
+	{
+		case addressing::horizontal:
+			if(column_ >= column_end_)
+			{
+				column_ = column_start_;
+				page_ = (page_ >= page_end_) ? page_start_ : static_cast<uint8_t>(page_ + 1);
+			}
+			else
+			{
+				column_++;
+			}
+			break;
+		case addressing::vertical:
+			if(page_ >= page_end_)
+			{
+				page_ = page_start_;
+				column_ =
+					(column_ >= column_end_) ? column_start_ : static_cast<uint8_t>(column_ + 1);
+			}
+			else
+			{
+				page_++;
+			}
+			break;
+		case addressing::page:
+			// The page is not advanced
+			column_ = (column_ >= GDRAM_COLUMNS - 1) ? page_mode_column_
+													 : static_cast<uint8_t>(column_ + 1);
+			break;
+	}
+}
+
+int ssd1306_emulator::rowForGlass(uint8_t row) const noexcept
+{
+	if(row >= mux_)
+	{
+		return -1;
+	}
+
+	const auto com = com_remap_ ? (mux_ - 1 - row) : row;
+	return (com + start_line_ + offset_) % GDRAM_ROWS;
+}
+
+uint8_t ssd1306_emulator::columnForGlass(uint8_t column) const noexcept
+{
+	const auto seg = static_cast<uint8_t>(panel_.column_offset + column);
+	return seg_remap_ ? static_cast<uint8_t>(GDRAM_COLUMNS - 1 - seg) : seg;
+}
+
+bool ssd1306_emulator::pixel(uint8_t x, uint8_t y) const noexcept
+{
+	assert(x < panel_.width && y < panel_.height);
+
+	if(!display_on_ || !charge_pump_)
+	{
+		return false;
+	}
+
+	const auto gx = panel_.rotated ? static_cast<uint8_t>(panel_.width - 1 - x) : x;
+	const auto gy = panel_.rotated ? static_cast<uint8_t>(panel_.height - 1 - y) : y;
+
+	const auto row = rowForGlass(gy);
+	if(row < 0)
+	{
+		return false;
+	}
+
+	if(entire_on_)
+	{
+		return true;
+	}
+
+	const auto byte = gdram_[row / canvas::PAGE_HEIGHT][columnForGlass(gx)];
+	const bool lit = ((byte >> (row % canvas::PAGE_HEIGHT)) & 0x1) != 0;
+
+	return lit != inverted_;
+}
+
+void ssd1306_emulator::render(canvas& out) const noexcept
+{
+	assert(out.width() >= panel_.width && out.height() >= panel_.height);
+
+	out.fill(0);
+
+	for(uint8_t y = 0; y < panel_.height; y++)
+	{
+		for(uint8_t x = 0; x < panel_.width; x++)
+		{
+			if(pixel(x, y))
+			{
+				*out.page(y / canvas::PAGE_HEIGHT, x) |=
+					static_cast<uint8_t>(1U << (y % canvas::PAGE_HEIGHT));
+			}
+		}
+	}
+}
@@ -0,0 +1,301 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_EMULATOR_HPP_
+#define SSD1306_EMULATOR_HPP_
+
+#include "canvas.hpp"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <driver/i2c.hpp>
+
+namespace embdrv
+{
+/// Physical arrangement of the panel connected to the emulated controller
+struct ssd1306_panel
+{
+	/// The number of segment lines connected to the glass
+	uint8_t width = 64;
+	/// The number of common lines connected to the glass
+	uint8_t height = 48;
+	/// The first segment line connected to the glass
+	uint8_t column_offset = 32;
+	/// The glass is mounted upside down, as on the MicroView. The default ssd1306 remap settings
+	/// then produce an upright image.
+	bool rotated = true;
+};
+
+/// Bus traffic observed by the emulator
+struct ssd1306_bus_stats
+{
+	/// The number of I2C transactions (START ... STOP). Continued writes are counted as part of
+	/// the transaction they continue.
+	uint32_t transactions = 0;
+	/// The number of bytes written after the address byte
+	uint32_t bytes = 0;
+	/// The number of control bytes
+	uint32_t control_bytes = 0;
+	/// The number of command bytes, including command arguments
+	uint32_t command_bytes = 0;
+	/// The number of data bytes written to GDRAM
+	uint32_t data_bytes = 0;
+	/// The number of protocol violations (e.g., unknown commands, GDRAM writes while scrolling,
+	/// or continued writes without an open transaction)
+	uint32_t violations = 0;
+};
+
+/** Host-side emulation of an SSD1306 controller on an I2C bus
+ *
+ * The emulator is an embvm::i2c::master that parses the control byte, command and data stream
+ * written to the controller address into an emulated 128 x 64 GDRAM, so the image the panel
+ * would show after a sequence of driver calls can be checked on a development machine. It
+ * models the addressing modes, column/page windows, display start line and offset, segment and
+ * COM remapping, multiplex ratio, inversion, display on/off, and the content scroll commands.
+ * Continuous scrolling is only tracked as state: the emulated image does not move.
+ *
+ * By default each transfer completes synchronously inside transfer(). With manual completion
+ * enabled, transfers are held until completeNext() is called, which allows tests to interleave
+ * drawing with in-flight transfers. The bytes of a transfer reach the controller when it
+ * completes, so buffers referenced by a transfer must be valid until then.
+ *
+ * This is intended for native builds only.
+ */
+class ssd1306_emulator final : public embvm::i2c::master
+{
+  public:
+	/// The number of columns in GDRAM
+	static constexpr uint8_t GDRAM_COLUMNS = 128;
+	/// The number of pages in GDRAM
+	static constexpr uint8_t GDRAM_PAGES = 8;
+	/// The number of rows in GDRAM
+	static constexpr uint8_t GDRAM_ROWS = GDRAM_PAGES * canvas::PAGE_HEIGHT;
+
+	/// Memory addressing modes (SET_ADDRESSING_MODE)
+	enum class addressing : uint8_t
+	{
+		horizontal = 0,
+		vertical = 1,
+		page = 2,
+	};
+
+	/// Create an emulated controller
+	/// @param address The I2C address of the controller. Other addresses are NACKed.
+	/// @param panel The arrangement of the panel connected to the controller.
+	explicit ssd1306_emulator(uint8_t address = 0x3C, ssd1306_panel panel = {}) noexcept;
+
+	~ssd1306_emulator() noexcept final = default;
+
+	/// Return the controller to its power-on reset state. GDRAM contents are preserved, as on
+	/// a real panel.
+	void reset() noexcept;
+
+	/// Check whether a pixel is lit on the panel
+	/// @param x The panel column, from the left as the panel is viewed.
+	/// @param y The panel row, from the top as the panel is viewed.
+	bool pixel(uint8_t x, uint8_t y) const noexcept;
+
+	/// Render the image shown on the panel
+	/// @param out A canvas at least as large as the panel, in the screen buffer layout.
+	void render(canvas& out) const noexcept;
+
+	/// Read a byte of GDRAM
+	uint8_t gdram(uint8_t page, uint8_t column) const noexcept
+	{
+		return gdram_[page][column];
+	}
+
+	/// Overwrite GDRAM, e.g. to start from random power-on contents
+	void fillGdram(uint8_t value) noexcept
+	{
+		for(auto& page : gdram_)
+		{
+			page.fill(value);
+		}
+	}
+
+	/// Check whether the display is switched on (DISPLAY_ON)
+	bool displayOn() const noexcept
+	{
+		return display_on_;
+	}
+
+	/// Check whether the display is inverted (INVERT_DISPLAY)
+	bool inverted() const noexcept
+	{
+		return inverted_;
+	}
+
+	/// Get the contrast setting
+	uint8_t contrast() const noexcept
+	{
+		return contrast_;
+	}
+
+	/// Get the display start line
+	uint8_t startLine() const noexcept
+	{
+		return start_line_;
+	}
+
+	/// Get the memory addressing mode
+	addressing addressingMode() const noexcept
+	{
+		return mode_;
+	}
+
+	/// Check whether continuous scrolling is active
+	bool scrollActive() const noexcept
+	{
+		return scroll_active_;
+	}
+
+	/// The number of content scroll commands (one-column shifts) executed
+	uint32_t contentScrolls() const noexcept
+	{
+		return content_scrolls_;
+	}
+
+	/// Get the bus traffic observed since the last resetStats()
+	const ssd1306_bus_stats& stats() const noexcept
+	{
+		return stats_;
+	}
+
+	/// Reset the bus traffic counters
+	void resetStats() noexcept
+	{
+		stats_ = {};
+	}
+
+	/** Hold transfers until they are completed explicitly
+	 *
+	 * @param manual True to queue transfers until completeNext() is called, false to complete
+	 *	them synchronously. Pending transfers must be completed before switching back.
+	 */
+	void manualCompletion(bool manual) noexcept
+	{
+		manual_ = manual;
+	}
+
+	/// Get the number of transfers waiting for completeNext()
+	size_t pending() const noexcept
+	{
+		return pending_.size();
+	}
+
+	/// Complete the oldest pending transfer
+	/// @param status The status reported to the driver. The bytes of the transfer only reach the
+	///	controller if the status is ok.
+	/// @returns false if no transfer was pending.
+	bool completeNext(embvm::i2c::status status = embvm::i2c::status::ok) noexcept;
+
+	/// Complete all pending transfers, including transfers queued by completion callbacks
+	void completeAll() noexcept;
+
+	/// Fail the next transfer with the given status (e.g., addrNACK), without delivering it
+	void failNext(embvm::i2c::status status) noexcept
+	{
+		fail_next_ = status;
+	}
+
+  private:
+	struct transfer_t
+	{
+		embvm::i2c::op_t op;
+		embvm::i2c::master::cb_t cb;
+	};
+
+	/// Parser state for the byte following the address byte or a data/command byte
+	enum class rx_state : uint8_t
+	{
+		control,
+		command_stream,
+		data_stream,
+		single_command,
+		single_data,
+	};
+
+	void start_() noexcept final {}
+	void stop_() noexcept final {}
+	void configure_(embvm::i2c::pullups pullup) noexcept final
+	{
+		(void)pullup;
+	}
+
+	embvm::i2c::status transfer_(const embvm::i2c::op_t& op,
+								 const embvm::i2c::master::cb_t& cb) noexcept final;
+
+	embvm::i2c::baud baudrate_(embvm::i2c::baud baud) noexcept final
+	{
+		return baud;
+	}
+
+	embvm::i2c::pullups setPullups_(embvm::i2c::pullups pullups) noexcept final
+	{
+		return pullups;
+	}
+
+	/// Deliver a transfer to the controller and invoke its callback
+	void complete(const transfer_t& t, embvm::i2c::status status) noexcept;
+
+	/// Parse the bytes of a write transfer
+	void receive(const embvm::i2c::op_t& op) noexcept;
+
+	void receiveByte(uint8_t b) noexcept;
+	void commandByte(uint8_t b) noexcept;
+	void dataByte(uint8_t b) noexcept;
+	void execute() noexcept;
+	void contentScroll(bool right) noexcept;
+
+	/// @returns the GDRAM row shown on a row of the glass, or -1 if the row is not driven
+	int rowForGlass(uint8_t row) const noexcept;
+
+	/// @returns the GDRAM column shown on a column of the glass
+	uint8_t columnForGlass(uint8_t column) const noexcept;
+
+	const uint8_t address_;
+	const ssd1306_panel panel_;
+
+	std::array<std::array<uint8_t, GDRAM_COLUMNS>, GDRAM_PAGES> gdram_{};
+
+	// Transaction and parser state
+	bool in_transaction_ = false;
+	rx_state rx_ = rx_state::control;
+	std::array<uint8_t, 8> cmd_{};
+	uint8_t cmd_size_ = 0;
+	uint8_t cmd_expected_ = 0;
+
+	// Controller registers
+	bool display_on_ = false;
+	bool inverted_ = false;
+	bool entire_on_ = false;
+	bool charge_pump_ = false;
+	bool seg_remap_ = false;
+	bool com_remap_ = false;
+	uint8_t contrast_ = 0x7F;
+	uint8_t mux_ = GDRAM_ROWS;
+	uint8_t offset_ = 0;
+	uint8_t start_line_ = 0;
+	addressing mode_ = addressing::page;
+	uint8_t page_mode_column_ = 0;
+	uint8_t column_start_ = 0;
+	uint8_t column_end_ = GDRAM_COLUMNS - 1;
+	uint8_t page_start_ = 0;
+	uint8_t page_end_ = GDRAM_PAGES - 1;
+	uint8_t column_ = 0;
+	uint8_t page_ = 0;
+	bool scroll_active_ = false;
+	uint32_t content_scrolls_ = 0;
+
+	ssd1306_bus_stats stats_{};
+
+	bool manual_ = false;
+	bool completing_ = false;
+	std::deque<transfer_t> pending_;
+	embvm::i2c::status fail_next_ = embvm::i2c::status::ok;
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_EMULATOR_HPP_
@@ -0,0 +1,437 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_MANAGER_HPP_
+#define SSD1306_MANAGER_HPP_
+
+#include "ssd1306.hpp"
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+namespace embdrv
+{
+/// Determines which pending panel is granted the bus next
+enum class schedule_policy : uint8_t
+{
+	/// Service pending panels in turn
+	roundRobin = 0,
+	/// Service the pending panel with the highest priority value.
+	/// Panels with equal priority are serviced in turn.
+	priority,
+	/// Service the pending panel whose frame period expires first (earliest deadline first).
+	/// Panels without a period are serviced after all panels with a period.
+	deadline,
+};
+
+/// Per-panel statistics reported by the ssd1306_manager
+struct panel_stats
+{
+	/// The number of frames uploaded since the statistics were reset
+	uint32_t frames = 0;
+	/// The number of bytes the panel wrote on the bus, including commands
+	uint32_t bytes = 0;
+	/// The number of frame uploads which reported an error
+	uint32_t errors = 0;
+	/// The achieved frame rate since the statistics were reset, in frames per second
+	float fps = 0.0F;
+};
+
+/** Schedules frame uploads for several SSD1306 panels sharing one I2C bus
+ *
+ * Panels registered with the manager defer their uploads: display() only marks the frame as
+ * pending. Each call to tick() grants the bus to one pending panel (according to the
+ * schedule_policy) if no frame upload is in progress, so frames from different panels are never
+ * interleaved on the bus. Panels are switched to queue_policy::coalesce so that commands issued
+ * by each panel are batched into as few transfers as possible.
+ *
+ * Only frame uploads are scheduled: other transfers (e.g., sleep(), wake(), or contrast()) are
+ * sent as they are issued, and may be interleaved with another panel's frame. Every transfer
+ * is a complete transaction, and each chunk of a frame sets its own window, so panels on the
+ * same bus segment do not disturb each other.
+ *
+ * If panels are behind an I2C mux, a select callback can be supplied for each panel. The mux is
+ * granted to one of these panels at a time, and held until all of its queued transfers have
+ * completed: an I2C master which queues transfers would otherwise send a panel's transfers to
+ * the channel selected for another panel. Transfers of other panels stay in their queues until
+ * the mux is released. The select callback is invoked whenever the mux is granted to a panel
+ * other than the one it was last switched to. It may be invoked from the I2C completion context.
+ *
+ * Frame completion may be reported from the I2C completion context, but new uploads are only
+ * started from tick(), which must be called from thread context.
+ *
+ * @tparam TMaxPanels The maximum number of panels which can be managed.
+ */
+template<size_t TMaxPanels = 4>
+class ssd1306_manager
+{
+  public:
+	/// Mux select callback
+	/// @param index The index of the panel which is about to send a transfer.
+	/// @param ctx The context pointer supplied with the callback.
+	using select_fn_t = void (*)(size_t index, void* ctx);
+
+	/// Create a panel manager
+	/// @param bus_hz The I2C bus frequency, used to compute the bus utilization.
+	/// @param policy The initial schedule policy.
+	explicit ssd1306_manager(uint32_t bus_hz = 400000,
+							 schedule_policy policy = schedule_policy::roundRobin) noexcept
+		: bus_hz_(bus_hz), policy_(policy)
+	{
+	}
+
+	/** Register a panel with the manager
+	 *
+	 * @param panel The panel to manage. It must outlive the manager.
+	 * @param priority The priority of the panel, used by schedule_policy::priority.
+	 * @param period_ms The target frame period of the panel, used by schedule_policy::deadline.
+	 *	A value of 0 indicates that the panel has no deadline.
+	 * @param select Optional mux select callback for the panel.
+	 * @param ctx Context pointer passed to the select callback.
+	 * @returns the index of the panel.
+	 */
+	size_t add(ssd1306& panel, uint8_t priority = 0, uint32_t period_ms = 0,
+			   select_fn_t select = nullptr, void* ctx = nullptr) noexcept
+	{
+		assert(count_ < TMaxPanels);
+
+		auto& e = panels_[count_];
+		e.panel = &panel;
+		e.priority = priority;
+		e.period_ms = period_ms;
+		e.select = select;
+		e.select_ctx = ctx;
+		e.owner = this;
+		e.index = count_;
+		e.bytes_base = panel.bytesSent();
+
+		if(select)
+		{
+			panel.submitHook(&ssd1306_manager::route, &e, &ssd1306_manager::release);
+		}
+
+		panel.deferUploads(true);
+		panel.transferQueuePolicy(queue_policy::coalesce);
+
+		return count_++;
+	}
+
+	/// Set the schedule policy
+	void policy(schedule_policy policy) noexcept
+	{
+		policy_ = policy;
+	}
+
+	/// Get the schedule policy
+	schedule_policy policy() const noexcept
+	{
+		return policy_;
+	}
+
+	/// Set the frame period for a panel
+	/// @param index The index of the panel returned by add().
+	/// @param period_ms The target frame period. 0 indicates that the panel has no deadline.
+	void period(size_t index, uint32_t period_ms) noexcept
+	{
+		assert(index < count_);
+		panels_[index].period_ms = period_ms;
+	}
+
+	/// Set the priority for a panel
+	/// @param index The index of the panel returned by add().
+	/// @param priority The new priority. Higher values are serviced first.
+	void priority(size_t index, uint8_t priority) noexcept
+	{
+		assert(index < count_);
+		panels_[index].priority = priority;
+	}
+
+	/** Grant the bus to the next pending panel
+	 *
+	 * If a frame upload is in progress, or no panel has a pending frame, this does nothing.
+	 *
+	 * @param now_ms The current time in milliseconds, used for deadlines and statistics.
+	 */
+	void tick(uint32_t now_ms) noexcept
+	{
+		now_ms_ = now_ms;
+
+		if(busy_.load())
+		{
+			return;
+		}
+
+		const auto next = selectNext(now_ms);
+		if(next == NO_PANEL)
+		{
+			return;
+		}
+
+		auto& e = panels_[next];
+
+		rr_next_ = (next + 1) % count_;
+		e.last_start_ms = now_ms;
+		e.started = true;
+
+		busy_ = true;
+		e.panel->uploadFrame([this, next](auto op, auto status) {
+			(void)op;
+			frameComplete(next, status);
+		});
+	}
+
+	/// Check whether a frame upload is in progress
+	bool busy() const noexcept
+	{
+		return busy_.load();
+	}
+
+	/// @returns the number of registered panels
+	size_t size() const noexcept
+	{
+		return count_;
+	}
+
+	/// Get the statistics for a panel
+	/// @param index The index of the panel returned by add().
+	/// @returns the panel statistics, with the frame rate computed up to the last tick().
+	panel_stats stats(size_t index) const noexcept
+	{
+		assert(index < count_);
+		const auto& e = panels_[index];
+
+		panel_stats s;
+		s.frames = e.frames;
+		s.bytes = bytes(e);
+		s.errors = e.errors;
+
+		const auto elapsed = elapsedMs();
+		if(elapsed != 0)
+		{
+			s.fps = static_cast<float>(e.frames) * MS_PER_S / static_cast<float>(elapsed);
+		}
+
+		return s;
+	}
+
+	/** Get the fraction of the bus capacity used by the panels
+	 *
+	 * This is an estimate: each byte costs 9 bit times (8 data bits + ACK). The START, address
+	 * byte, and STOP of each transfer are not accounted for.
+	 *
+	 * @returns the bus utilization since the statistics were reset, from 0.0 to 1.0.
+	 */
+	float busUtilization() const noexcept
+	{
+		const auto elapsed = elapsedMs();
+		if(elapsed == 0 || bus_hz_ == 0)
+		{
+			return 0.0F;
+		}
+
+		uint64_t bytes = 0;
+		for(size_t i = 0; i < count_; i++)
+		{
+			bytes += this->bytes(panels_[i]);
+		}
+
+		const auto bit_times = static_cast<float>(bytes * BITS_PER_BYTE_ON_BUS);
+		const auto capacity = static_cast<float>(bus_hz_) * static_cast<float>(elapsed) / MS_PER_S;
+		return bit_times / capacity;
+	}
+
+	/// Reset the statistics for all panels
+	/// @param now_ms The current time in milliseconds, which starts the new measurement window.
+	void resetStats(uint32_t now_ms) noexcept
+	{
+		for(size_t i = 0; i < count_; i++)
+		{
+			panels_[i].frames = 0;
+			panels_[i].bytes_base = panels_[i].panel->bytesSent();
+			panels_[i].errors = 0;
+		}
+
+		stats_start_ms_ = now_ms;
+		now_ms_ = now_ms;
+	}
+
+  private:
+	static constexpr size_t NO_PANEL = TMaxPanels;
+	static constexpr uint32_t BITS_PER_BYTE_ON_BUS = 9;
+	static constexpr float MS_PER_S = 1000.0F;
+
+	struct entry
+	{
+		ssd1306* panel = nullptr;
+		uint8_t priority = 0;
+		uint32_t period_ms = 0;
+		uint32_t last_start_ms = 0;
+		bool started = false;
+		select_fn_t select = nullptr;
+		void* select_ctx = nullptr;
+		ssd1306_manager* owner = nullptr;
+		size_t index = 0;
+		/// Set while the panel has a transfer held back by route()
+		std::atomic<bool> waiting{false};
+		uint32_t frames = 0;
+		/// The panel's bytesSent() when the statistics were reset
+		uint32_t bytes_base = 0;
+		uint32_t errors = 0;
+	};
+
+	uint32_t elapsedMs() const noexcept
+	{
+		return now_ms_ - stats_start_ms_;
+	}
+
+	static uint32_t bytes(const entry& e) noexcept
+	{
+		// Unsigned subtraction handles wraparound of the counter
+		return e.panel->bytesSent() - e.bytes_base;
+	}
+
+	/// Submit hook installed on panels with a select callback
+	/// @returns false if another panel holds the mux.
+	static bool route(void* ctx) noexcept
+	{
+		auto& e = *static_cast<entry*>(ctx);
+		auto& m = *e.owner;
+
+		// Announce the wait before trying, so a concurrent release() cannot miss us
+		e.waiting = true;
+
+		auto holder = NO_PANEL;
+		if(!m.mux_holder_.compare_exchange_strong(holder, e.index) && holder != e.index)
+		{
+			return false;
+		}
+
+		e.waiting = false;
+
+		if(m.selected_.exchange(e.index) != e.index)
+		{
+			e.select(e.index, e.select_ctx);
+		}
+
+		return true;
+	}
+
+	/// Idle hook installed on panels with a select callback: release the mux and resume the
+	/// panels waiting for it
+	static void release(void* ctx) noexcept
+	{
+		auto& e = *static_cast<entry*>(ctx);
+		auto& m = *e.owner;
+
+		auto holder = e.index;
+		if(!m.mux_holder_.compare_exchange_strong(holder, NO_PANEL))
+		{
+			return;
+		}
+
+		for(size_t n = 1; n < m.count_; n++)
+		{
+			auto& other = m.panels_[(e.index + n) % m.count_];
+			if(other.waiting.exchange(false))
+			{
+				other.panel->resumeTransfers();
+			}
+		}
+	}
+
+	void frameComplete(size_t index, embvm::i2c::status status) noexcept
+	{
+		auto& e = panels_[index];
+		e.frames++;
+		if(status != embvm::i2c::status::ok)
+		{
+			e.errors++;
+		}
+
+		busy_ = false;
+	}
+
+	size_t selectNext(uint32_t now_ms) const noexcept
+	{
+		size_t best = NO_PANEL;
+
+		// Walk the panels starting at the round-robin position so ties are serviced in turn
+		for(size_t n = 0; n < count_; n++)
+		{
+			const auto i = (rr_next_ + n) % count_;
+			const auto& e = panels_[i];
+
+			if(!e.panel->framePending())
+			{
+				continue;
+			}
+
+			if(best == NO_PANEL || policy_ == schedule_policy::roundRobin)
+			{
+				if(best == NO_PANEL)
+				{
+					best = i;
+				}
+
+				continue;
+			}
+
+			const auto& b = panels_[best];
+			if(policy_ == schedule_policy::priority)
+			{
+				if(e.priority > b.priority)
+				{
+					best = i;
+				}
+			}
+			else if(timeToDeadline(e, now_ms) < timeToDeadline(b, now_ms))
+			{
+				best = i;
+			}
+		}
+
+		return best;
+	}
+
+	static int32_t timeToDeadline(const entry& e, uint32_t now_ms) noexcept
+	{
+		if(e.period_ms == 0)
+		{
+			return INT32_MAX;
+		}
+
+		if(!e.started)
+		{
+			return INT32_MIN;
+		}
+
+		// Unsigned subtraction handles wraparound of the millisecond counter
+		return static_cast<int32_t>(e.last_start_ms + e.period_ms - now_ms);
+	}
+
+	std::array<entry, TMaxPanels> panels_{};
+	size_t count_ = 0;
+
+	/// The panel to consider first in the next scheduling decision
+	size_t rr_next_ = 0;
+
+	/// The panel which the mux was last switched to. Updated from the submit hooks.
+	std::atomic<size_t> selected_{NO_PANEL};
+
+	/// The panel which holds the mux while it has transfers queued, or NO_PANEL
+	std::atomic<size_t> mux_holder_{NO_PANEL};
+
+	const uint32_t bus_hz_;
+	schedule_policy policy_;
+
+	/// Indicates that a frame upload is in progress. Cleared from the completion context.
+	std::atomic<bool> busy_{false};
+
+	uint32_t stats_start_ms_ = 0;
+	uint32_t now_ms_ = 0;
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_MANAGER_HPP_
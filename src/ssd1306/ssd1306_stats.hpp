@@ -0,0 +1,275 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_STATS_HPP_
+#define SSD1306_STATS_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Enable the ssd1306 runtime statistics block. Set with the `enable-ssd1306-stats` option.
+/// When disabled, the instrumentation hooks compile to nothing.
+#ifndef SSD1306_ENABLE_STATS
+#define SSD1306_ENABLE_STATS 0
+#endif
+
+namespace embdrv
+{
+/// Operations which are instrumented by the ssd1306 statistics block
+enum class ssd1306_op : uint8_t
+{
+	/// Time spent in display(), excluding the asynchronous upload
+	display = 0,
+	/// Time from submitting an I2C transaction to its completion
+	transfer,
+	pixel,
+	/// Batched point plotting with pixels()
+	pixels,
+	line,
+	rect,
+	rectFill,
+	circle,
+	circleFill,
+	drawChar,
+	drawBitmap,
+	clear,
+	/// Region operations (invert, copy, move, and scroll)
+	region,
+	/// The number of instrumented operations
+	count,
+};
+
+/// Counters and timing for a single instrumented operation
+struct ssd1306_op_stats
+{
+	/// The number of times the operation was invoked
+	uint32_t calls = 0;
+	/// The number of pixels touched by the operation (including nested operations)
+	uint32_t pixels = 0;
+	/// The shortest invocation, in statistics clock ticks
+	uint32_t min = UINT32_MAX;
+	/// The longest invocation, in statistics clock ticks
+	uint32_t max = 0;
+	/// The sum of all invocations, in statistics clock ticks
+	uint32_t total = 0;
+
+	/// @returns the average duration of an invocation, in statistics clock ticks
+	uint32_t avg() const noexcept
+	{
+		return calls ? total / calls : 0;
+	}
+
+	/// Record the duration of one invocation
+	void record(uint32_t elapsed) noexcept
+	{
+		calls++;
+		total += elapsed;
+		min = elapsed < min ? elapsed : min;
+		max = elapsed > max ? elapsed : max;
+	}
+};
+
+/// Runtime statistics for an ssd1306 instance
+struct ssd1306_stats
+{
+	/// The number of I2C transactions submitted
+	uint32_t transactions = 0;
+	/// The number of bytes submitted in those transactions
+	uint32_t bytes = 0;
+	/// The number of transactions which completed with an error
+	uint32_t errors = 0;
+	/// The number of occupied transfer queue slots
+	uint32_t queue_occupancy = 0;
+	/// The maximum number of simultaneously occupied transfer queue slots
+	uint32_t queue_high_water_mark = 0;
+	/// Per-operation counters, indexed by ssd1306_op
+	std::array<ssd1306_op_stats, static_cast<size_t>(ssd1306_op::count)> ops{};
+
+	/// Access the counters for an operation
+	const ssd1306_op_stats& op(ssd1306_op o) const noexcept
+	{
+		return ops[static_cast<size_t>(o)];
+	}
+};
+
+/// Function which returns the current time for statistics timing, in any monotonic unit
+/// (e.g., microseconds or timer ticks)
+using ssd1306_stats_clock_t = uint32_t (*)();
+
+#if SSD1306_ENABLE_STATS
+
+/** Collects ssd1306 statistics
+ *
+ * Timing is only recorded if a clock has been supplied. Pixels are attributed to the outermost
+ * instrumented operation which is active (e.g., the pixels drawn by rect() are not also
+ * attributed to the line() calls it makes).
+ *
+ * Transactions are recorded from the I2C completion context, so their counters are atomic and
+ * may be read or reset from thread context at any time. While transactions are in flight, a
+ * snapshot may count a transaction in one counter but not yet in another.
+ */
+class ssd1306_stats_collector
+{
+  public:
+	/// Records the duration of an operation for the lifetime of the scope
+	class scope
+	{
+	  public:
+		scope(ssd1306_stats_collector& c, ssd1306_op op) noexcept
+			: c_(c), op_(op), prev_(c.active_), start_(c.now())
+		{
+			if(prev_ == ssd1306_op::count)
+			{
+				c_.active_ = op;
+			}
+		}
+
+		~scope() noexcept
+		{
+			c_.record(op_, c_.now() - start_);
+			c_.active_ = prev_;
+		}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+		scope(scope&&) = delete;
+		scope& operator=(scope&&) = delete;
+
+	  private:
+		ssd1306_stats_collector& c_;
+		const ssd1306_op op_;
+		const ssd1306_op prev_;
+		const uint32_t start_;
+	};
+
+	/// Set the clock used for timing
+	void clock(ssd1306_stats_clock_t clk) noexcept
+	{
+		clock_ = clk;
+	}
+
+	/// @returns the current time, or 0 if no clock is set
+	uint32_t now() const noexcept
+	{
+		return clock_ ? clock_() : 0;
+	}
+
+	/// Record the duration of one invocation of an operation
+	void record(ssd1306_op op, uint32_t elapsed) noexcept
+	{
+		stats_.ops[static_cast<size_t>(op)].record(elapsed);
+	}
+
+	/// Attribute touched pixels to the active operation
+	/// @param count The number of pixels touched.
+	void pixel(uint32_t count = 1) noexcept
+	{
+		const auto op = active_ == ssd1306_op::count ? ssd1306_op::pixel : active_;
+		stats_.ops[static_cast<size_t>(op)].pixels += count;
+	}
+
+	/// Record a submitted transaction (may be called from the I2C completion context)
+	/// @param bytes The number of bytes in the transaction.
+	void transfer(uint32_t bytes) noexcept
+	{
+		transfers_.transactions.fetch_add(1, std::memory_order_relaxed);
+		transfers_.bytes.fetch_add(bytes, std::memory_order_relaxed);
+		transfers_.start.store(now(), std::memory_order_relaxed);
+	}
+
+	/// Record a completed transaction (may be called from the I2C completion context)
+	/// @param ok True if the transaction completed successfully.
+	void transferComplete(bool ok) noexcept
+	{
+		const auto elapsed = now() - transfers_.start.load(std::memory_order_relaxed);
+
+		// Transfers are submitted and completed one at a time, so there is a single writer
+		transfers_.calls.fetch_add(1, std::memory_order_relaxed);
+		transfers_.total.fetch_add(elapsed, std::memory_order_relaxed);
+		if(elapsed < transfers_.min.load(std::memory_order_relaxed))
+		{
+			transfers_.min.store(elapsed, std::memory_order_relaxed);
+		}
+		if(elapsed > transfers_.max.load(std::memory_order_relaxed))
+		{
+			transfers_.max.store(elapsed, std::memory_order_relaxed);
+		}
+
+		if(!ok)
+		{
+			transfers_.errors.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/// @returns a snapshot of the collected statistics
+	ssd1306_stats stats() const noexcept
+	{
+		auto s = stats_;
+		s.transactions = transfers_.transactions.load(std::memory_order_relaxed);
+		s.bytes = transfers_.bytes.load(std::memory_order_relaxed);
+		s.errors = transfers_.errors.load(std::memory_order_relaxed);
+
+		auto& t = s.ops[static_cast<size_t>(ssd1306_op::transfer)];
+		t.calls = transfers_.calls.load(std::memory_order_relaxed);
+		t.total = transfers_.total.load(std::memory_order_relaxed);
+		t.min = transfers_.min.load(std::memory_order_relaxed);
+		t.max = transfers_.max.load(std::memory_order_relaxed);
+
+		return s;
+	}
+
+	/// Reset the collected statistics
+	void reset() noexcept
+	{
+		stats_ = {};
+		transfers_.transactions.store(0, std::memory_order_relaxed);
+		transfers_.bytes.store(0, std::memory_order_relaxed);
+		transfers_.errors.store(0, std::memory_order_relaxed);
+		transfers_.calls.store(0, std::memory_order_relaxed);
+		transfers_.total.store(0, std::memory_order_relaxed);
+		transfers_.min.store(UINT32_MAX, std::memory_order_relaxed);
+		transfers_.max.store(0, std::memory_order_relaxed);
+	}
+
+  private:
+	/// Transaction counters, which are updated from the I2C completion context
+	struct transfer_counters
+	{
+		std::atomic<uint32_t> transactions{0};
+		std::atomic<uint32_t> bytes{0};
+		std::atomic<uint32_t> errors{0};
+		std::atomic<uint32_t> calls{0};
+		std::atomic<uint32_t> total{0};
+		std::atomic<uint32_t> min{UINT32_MAX};
+		std::atomic<uint32_t> max{0};
+		/// The time the in-flight transaction was submitted
+		std::atomic<uint32_t> start{0};
+	};
+
+	/// Drawing counters, which are only updated from thread context
+	ssd1306_stats stats_{};
+	transfer_counters transfers_{};
+	ssd1306_stats_clock_t clock_ = nullptr;
+	ssd1306_op active_ = ssd1306_op::count;
+};
+
+// NOLINTNEXTLINE
+#define SSD1306_STATS_SCOPE(op) \
+	const ssd1306_stats_collector::scope ssd1306_stats_scope_(stats_, op)
+// NOLINTNEXTLINE
+#define SSD1306_STATS(expr) stats_.expr
+
+#else
+
+// NOLINTNEXTLINE
+#define SSD1306_STATS_SCOPE(op)
+// NOLINTNEXTLINE
+#define SSD1306_STATS(expr)
+
+#endif // SSD1306_ENABLE_STATS
+
+} // namespace embdrv
+
+#endif // SSD1306_STATS_HPP_
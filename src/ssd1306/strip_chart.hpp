@@ -0,0 +1,243 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_STRIP_CHART_HPP_
+#define SSD1306_STRIP_CHART_HPP_
+
+#include "ssd1306.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace embdrv
+{
+/** Streaming strip chart for live sensor plots
+ *
+ * Each new sample is appended as a single column at the right edge of the display. Instead of
+ * shifting and re-uploading the whole frame, the chart shifts the controller memory one column
+ * to the left with the content scroll command and writes the new column in vertical addressing
+ * mode. A new sample costs a scroll command and SCREEN_PAGES data bytes on the bus.
+ *
+ * Each column holds one sample per trace. A sample is a min/max pair, drawn as a vertical span,
+ * so envelopes can be plotted by pushing the extremes of each sample period. All traces share
+ * the same vertical scale. With autoscaling enabled, a sample outside of the current range
+ * widens the range and the whole chart is redrawn from the sample history.
+ *
+ * The chart owns the display between begin() and end(): the screen buffer is not shown, and
+ * display() must not be called. The controller can only complete one content scroll per frame
+ * period, so samples should not be pushed faster than the panel frame rate (~100 Hz).
+ *
+ * @tparam TTraces The number of traces plotted in the chart.
+ */
+template<size_t TTraces = 1>
+class strip_chart
+{
+	static_assert(TTraces > 0, "Strip chart needs at least one trace");
+
+  public:
+	/// A single sample of one trace
+	struct sample
+	{
+		/// The smallest value observed during the sample period
+		int16_t min;
+		/// The largest value observed during the sample period
+		int16_t max;
+	};
+
+	using samples_t = std::array<sample, TTraces>;
+	using values_t = std::array<int16_t, TTraces>;
+
+	/// Create a strip chart
+	/// @param display The display to plot on.
+	/// @param min The value plotted at the bottom of the chart.
+	/// @param max The value plotted at the top of the chart.
+	/// @param autoscale If true, the range is widened to fit samples outside of it.
+	strip_chart(ssd1306& display, int16_t min, int16_t max, bool autoscale = true) noexcept
+		: display_(display), min_(min), max_(max), autoscale_(autoscale)
+	{
+		assert(min < max);
+	}
+
+	/// Take over the display and draw the sample history
+	void begin() noexcept
+	{
+		display_.beginColumnStream();
+		redraw();
+	}
+
+	/// Release the display. The next display() uploads the screen buffer.
+	void end() noexcept
+	{
+		display_.endColumnStream();
+	}
+
+	/// Append a point sample for each trace
+	/// @param values The value of each trace.
+	void push(const values_t& values) noexcept
+	{
+		samples_t samples;
+		for(size_t t = 0; t < TTraces; t++)
+		{
+			samples[t] = {values[t], values[t]};
+		}
+
+		pushEnvelope(samples);
+	}
+
+	/// Append a min/max sample for each trace
+	/// @param samples The min/max envelope of each trace for the sample period.
+	void pushEnvelope(const samples_t& samples) noexcept
+	{
+		newest_ = (newest_ + 1) % COLUMNS;
+		history_[newest_] = samples;
+		count_ = std::min<size_t>(count_ + 1, COLUMNS);
+
+		if(autoscale_ && fitRange(samples))
+		{
+			redraw();
+			return;
+		}
+
+		column_t column;
+		renderColumn(newest_, column);
+
+		display_.scrollColumnsLeft();
+		display_.streamColumn(column.data());
+	}
+
+	/// Set the plotted range and redraw the chart
+	/// @param min The value plotted at the bottom of the chart.
+	/// @param max The value plotted at the top of the chart.
+	void range(int16_t min, int16_t max) noexcept
+	{
+		assert(min < max);
+		min_ = min;
+		max_ = max;
+		redraw();
+	}
+
+	/// Discard the sample history and blank the chart
+	void clear() noexcept
+	{
+		count_ = 0;
+		redraw();
+	}
+
+	/** Redraw all columns from the sample history
+	 *
+	 * This costs a full frame on the bus, so it is only used when the scale changes. The chart
+	 * is rendered into frame_ and sent with one transaction per page.
+	 *
+	 * If the previous redraw is still being sent, its remaining rows may pick up the new
+	 * contents. They are all sent again by this redraw, so the panel ends up with the new chart.
+	 */
+	void redraw() noexcept
+	{
+		// Oldest column first, so the newest sample lands at the right edge
+		for(size_t x = 0; x < COLUMNS; x++)
+		{
+			column_t column;
+			const auto age = COLUMNS - 1 - x;
+
+			if(age < count_)
+			{
+				renderColumn((newest_ + COLUMNS - age) % COLUMNS, column);
+			}
+			else
+			{
+				column.fill(0);
+			}
+
+			for(uint16_t page = 0; page < ssd1306::SCREEN_PAGES; page++)
+			{
+				*frame_.page(page, static_cast<uint16_t>(x)) = column[page];
+			}
+		}
+
+		display_.streamCanvas(frame_);
+	}
+
+  private:
+	static constexpr size_t COLUMNS = ssd1306::SCREEN_WIDTH;
+	static constexpr int32_t BOTTOM_ROW = ssd1306::SCREEN_HEIGHT - 1;
+
+	using column_t = std::array<uint8_t, ssd1306::SCREEN_PAGES>;
+
+	/// Widen the range to fit the samples, leaving 1/8 of the range as headroom
+	/// @returns true if the range changed.
+	bool fitRange(const samples_t& samples) noexcept
+	{
+		int32_t lo = min_;
+		int32_t hi = max_;
+
+		for(const auto& s : samples)
+		{
+			lo = std::min<int32_t>(lo, s.min);
+			hi = std::max<int32_t>(hi, s.max);
+		}
+
+		if(lo == min_ && hi == max_)
+		{
+			return false;
+		}
+
+		const auto headroom = (hi - lo) / 8;
+		lo -= (lo < min_) ? headroom : 0;
+		hi += (hi > max_) ? headroom : 0;
+
+		min_ = static_cast<int16_t>(std::max<int32_t>(lo, INT16_MIN));
+		max_ = static_cast<int16_t>(std::min<int32_t>(hi, INT16_MAX));
+		return true;
+	}
+
+	/// Convert a value to a display row, clamped to the chart
+	uint8_t toRow(int16_t value) const noexcept
+	{
+		const auto clamped = std::clamp<int32_t>(value, min_, max_);
+		const auto span = static_cast<int32_t>(max_) - min_;
+		const auto offset = ((clamped - min_) * BOTTOM_ROW) / span;
+		return static_cast<uint8_t>(BOTTOM_ROW - offset);
+	}
+
+	/// Render the samples of one history column into page bytes
+	void renderColumn(size_t index, column_t& column) const noexcept
+	{
+		column.fill(0);
+
+		for(const auto& s : history_[index])
+		{
+			// Larger values are plotted closer to the top of the screen
+			const auto top = toRow(std::max(s.min, s.max));
+			const auto bottom = toRow(std::min(s.min, s.max));
+
+			for(auto y = top; y <= bottom; y++)
+			{
+				column[y / canvas::PAGE_HEIGHT] |=
+					static_cast<uint8_t>(1U << (y % canvas::PAGE_HEIGHT));
+			}
+		}
+	}
+
+	ssd1306& display_;
+
+	/// The chart contents sent by redraw()
+	static_canvas<ssd1306::SCREEN_WIDTH, ssd1306::SCREEN_HEIGHT> frame_;
+
+	/// Ring buffer of samples, one entry per column
+	std::array<samples_t, COLUMNS> history_{};
+
+	/// Index of the newest sample in the history
+	size_t newest_ = COLUMNS - 1;
+
+	/// The number of valid samples in the history
+	size_t count_ = 0;
+
+	int16_t min_;
+	int16_t max_;
+	bool autoscale_;
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_STRIP_CHART_HPP_
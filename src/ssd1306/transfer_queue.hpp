@@ -0,0 +1,308 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#ifndef SSD1306_TRANSFER_QUEUE_HPP_
+#define SSD1306_TRANSFER_QUEUE_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <driver/i2c.hpp>
+
+namespace embdrv
+{
+/// Determines what happens when a transfer is queued and the transfer queue is full
+enum class queue_policy : uint8_t
+{
+	/// Wait for the in-flight transfer to complete and free a slot. The transfer is dropped
+	/// if the wait gives up. Must not be used from the I2C completion context.
+	block = 0,
+	/// Discard the new transfer
+	drop,
+	/// Append the new bytes to the most recently queued transfer whenever it has not been
+	/// submitted yet and has room, reducing the number of transfers on the bus.
+	/// Falls back to blocking if coalescing is not possible and the queue is full.
+	coalesce,
+};
+
+/// Usage statistics for a transfer_queue
+struct transfer_queue_stats
+{
+	/// The number of transfers which were added to the queue
+	uint32_t enqueued = 0;
+	/// The number of transfers which were discarded because the queue was full
+	uint32_t dropped = 0;
+	/// The number of transfers which were merged into an already-queued transfer
+	uint32_t coalesced = 0;
+	/// The maximum number of simultaneously occupied slots
+	uint32_t high_water_mark = 0;
+};
+
+/** A bounded, lock-free queue of I2C transfer descriptors
+ *
+ * The queue supports multiple producers (e.g., several RTOS threads) and a single consumer,
+ * which is expected to submit one transfer at a time and release it from the I2C completion
+ * callback (which may run in interrupt context). No dynamic allocation is performed: small
+ * transfers are copied into the descriptor's payload, larger transfers reference an external
+ * buffer which must remain valid until the transfer completes.
+ *
+ * Each slot moves through the states free -> writing -> ready -> inFlight -> free. Producers
+ * reserve slots by advancing the tail with a CAS, and the consumer only takes the head slot
+ * once it is ready, so transfers are submitted in reservation order.
+ *
+ * @tparam TCapacity The number of descriptors in the queue. Must be a power of two.
+ * @tparam TPayloadSize The number of bytes which can be stored inside of a descriptor.
+ */
+template<size_t TCapacity, size_t TPayloadSize>
+class transfer_queue
+{
+	static_assert(TCapacity > 1 && (TCapacity & (TCapacity - 1)) == 0,
+				  "Transfer queue capacity must be a power of two");
+	static_assert(TPayloadSize >= 2, "Payload must fit a control byte and a command");
+
+  public:
+	/// Description of a single I2C write transfer
+	struct descriptor
+	{
+		/// The I2C operation to perform
+		embvm::i2c::operation op = embvm::i2c::operation::write;
+		/// The number of bytes to send
+		uint16_t size = 0;
+		/// External transmit buffer. If nullptr, the payload is sent.
+		const uint8_t* buffer = nullptr;
+		/// Optional callback which is invoked once the transfer completes
+		embvm::i2c::master::cb_t cb = nullptr;
+		/// Inline storage for small transfers
+		uint8_t payload[TPayloadSize] = {0};
+
+		/// @returns the buffer to transmit for this descriptor
+		const uint8_t* data() const noexcept
+		{
+			return buffer ? buffer : payload;
+		}
+	};
+
+	/// Reserve descriptors at the tail of the queue
+	/// @param count The number of consecutive descriptors to reserve. Use next() to access the
+	///		descriptors which follow the first one.
+	/// @returns a pointer to the first reserved descriptor, or nullptr if the queue does not have
+	///		room. Each descriptor must be handed back with publish().
+	descriptor* reserve(size_t count = 1) noexcept
+	{
+		assert(count > 0 && count <= TCapacity);
+
+		auto tail = tail_.load(std::memory_order_acquire);
+		do
+		{
+			if(tail + count - head_.load(std::memory_order_acquire) > TCapacity)
+			{
+				return nullptr;
+			}
+		} while(!tail_.compare_exchange_weak(tail, tail + count, std::memory_order_acq_rel,
+											 std::memory_order_acquire));
+
+		// The head only advances once a slot is free, so these slots are ours
+		for(size_t i = 0; i < count; i++)
+		{
+			const auto index = (tail + i) & INDEX_MASK;
+			states_[index].store(state::writing, std::memory_order_relaxed);
+
+			auto& d = descriptors_[index];
+			d.op = embvm::i2c::operation::write;
+			d.size = 0;
+			d.buffer = nullptr;
+			d.cb = nullptr;
+		}
+
+		updateHighWaterMark(tail + count - head_.load(std::memory_order_acquire));
+		stats_.enqueued += static_cast<uint32_t>(count);
+
+		return &descriptors_[tail & INDEX_MASK];
+	}
+
+	/// Get the descriptor which follows a reserved descriptor
+	descriptor* next(descriptor* d) noexcept
+	{
+		assert(d >= descriptors_ && d < &descriptors_[TCapacity]);
+		return &descriptors_[static_cast<size_t>((d - descriptors_) + 1) & INDEX_MASK];
+	}
+
+	/// Mark a descriptor returned by reserve() or coalesce() as ready for submission
+	void publish(descriptor* d) noexcept
+	{
+		assert(d >= descriptors_ && d < &descriptors_[TCapacity]);
+		states_[d - descriptors_].store(state::ready, std::memory_order_release);
+	}
+
+	/** Lock the most recently queued descriptor for appending bytes
+	 *
+	 * Succeeds only if the descriptor has not been submitted yet, is a complete write which does
+	 * not use an external buffer, starts with the same control byte, and has room for `count`
+	 * more bytes.
+	 *
+	 * @param control The control byte which must lead the queued descriptor.
+	 * @param count The number of bytes which will be appended.
+	 * @returns a pointer to the locked descriptor, or nullptr if coalescing is not possible.
+	 *	The descriptor must be handed back with publish().
+	 */
+	descriptor* coalesce(uint8_t control, size_t count) noexcept
+	{
+		const auto tail = tail_.load(std::memory_order_acquire);
+		if(tail == head_.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+
+		const auto index = (tail - 1) & INDEX_MASK;
+		auto expected = state::ready;
+		if(!states_[index].compare_exchange_strong(expected, state::writing,
+												   std::memory_order_acq_rel))
+		{
+			return nullptr;
+		}
+
+		// A newer transfer was reserved (or the slot was recycled) while we were locking it;
+		// appending here would reorder bytes.
+		auto& d = descriptors_[index];
+		if(tail_.load(std::memory_order_acquire) != tail ||
+		   d.op != embvm::i2c::operation::write || d.buffer != nullptr || d.size == 0 ||
+		   d.payload[0] != control || (d.size + count) > TPayloadSize)
+		{
+			states_[index].store(state::ready, std::memory_order_release);
+			return nullptr;
+		}
+
+		stats_.coalesced++;
+		return &d;
+	}
+
+	/// Take the descriptor at the head of the queue for submission (consumer only)
+	/// @returns the head descriptor, or nullptr if the queue is empty or the head is not ready.
+	descriptor* acquire() noexcept
+	{
+		const auto head = head_.load(std::memory_order_relaxed);
+		if(head == tail_.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+
+		const auto index = head & INDEX_MASK;
+		auto expected = state::ready;
+		if(!states_[index].compare_exchange_strong(expected, state::inFlight,
+												   std::memory_order_acq_rel))
+		{
+			return nullptr;
+		}
+
+		return &descriptors_[index];
+	}
+
+	/// Check whether the descriptor at the head of the queue is ready for submission
+	bool ready() const noexcept
+	{
+		const auto head = head_.load(std::memory_order_relaxed);
+		return head != tail_.load(std::memory_order_acquire) &&
+			   states_[head & INDEX_MASK].load(std::memory_order_acquire) == state::ready;
+	}
+
+	/// Access the in-flight descriptor at the head of the queue (consumer only)
+	descriptor& front() noexcept
+	{
+		return descriptors_[head_.load(std::memory_order_relaxed) & INDEX_MASK];
+	}
+
+	/// Free the in-flight descriptor at the head of the queue (consumer only)
+	void release() noexcept
+	{
+		const auto head = head_.load(std::memory_order_relaxed);
+		states_[head & INDEX_MASK].store(state::free, std::memory_order_release);
+		head_.store(head + 1, std::memory_order_release);
+	}
+
+	/// @returns the number of occupied slots
+	size_t size() const noexcept
+	{
+		return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+	}
+
+	/// @returns the number of slots in the queue
+	static constexpr size_t capacity() noexcept
+	{
+		return TCapacity;
+	}
+
+	/// @returns the number of bytes which can be stored inside of a descriptor
+	static constexpr size_t payloadSize() noexcept
+	{
+		return TPayloadSize;
+	}
+
+	/// Record a transfer which was discarded by the caller's queue policy
+	void recordDrop() noexcept
+	{
+		stats_.dropped++;
+	}
+
+	/// @returns a snapshot of the queue statistics
+	transfer_queue_stats stats() const noexcept
+	{
+		return {stats_.enqueued.load(), stats_.dropped.load(), stats_.coalesced.load(),
+				stats_.high_water_mark.load()};
+	}
+
+	/// Reset the queue statistics. The high water mark restarts from the current occupancy.
+	void resetStats() noexcept
+	{
+		stats_.enqueued = 0;
+		stats_.dropped = 0;
+		stats_.coalesced = 0;
+		stats_.high_water_mark = static_cast<uint32_t>(size());
+	}
+
+  private:
+	static constexpr size_t INDEX_MASK = TCapacity - 1;
+
+	enum class state : uint8_t
+	{
+		free = 0,
+		writing,
+		ready,
+		inFlight,
+	};
+
+	void updateHighWaterMark(size_t occupancy) noexcept
+	{
+		auto hwm = stats_.high_water_mark.load(std::memory_order_relaxed);
+		while(occupancy > hwm &&
+			  !stats_.high_water_mark.compare_exchange_weak(hwm, static_cast<uint32_t>(occupancy),
+															std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/// Counters are atomic because producers may run in separate threads
+	struct
+	{
+		std::atomic<uint32_t> enqueued{0};
+		std::atomic<uint32_t> dropped{0};
+		std::atomic<uint32_t> coalesced{0};
+		std::atomic<uint32_t> high_water_mark{0};
+	} stats_;
+
+	/// Transfer descriptors, indexed by queue position modulo the capacity
+	descriptor descriptors_[TCapacity];
+
+	/// The state of each descriptor slot
+	std::atomic<state> states_[TCapacity] = {};
+
+	/// Index of the next descriptor to submit. Only written by the consumer.
+	std::atomic<size_t> head_{0};
+
+	/// Index of the next descriptor to reserve. Advanced by producers.
+	std::atomic<size_t> tail_{0};
+};
+
+} // namespace embdrv
+
+#endif // SSD1306_TRANSFER_QUEUE_HPP_
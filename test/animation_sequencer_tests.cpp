@@ -0,0 +1,116 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#include "animation_sequencer.hpp"
+#include "frame_mirror.hpp"
+#include "ssd1306_emulator.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace embdrv;
+
+namespace
+{
+using color = embvm::basicDisplay::color;
+using mode = embvm::basicDisplay::mode;
+
+/// Toggles one pixel per step, moving right along a row
+class marching_dot final : public animation
+{
+  public:
+	int steps = 0;
+
+	animation_result step(ssd1306& display, uint32_t now_ms) noexcept final
+	{
+		(void)now_ms;
+		display.pixel(static_cast<ssd1306::coord_t>(steps % ssd1306::SCREEN_WIDTH), 5,
+					  color::white, mode::XOR);
+		steps++;
+		return animation_result::nextFrame();
+	}
+};
+
+/// Counts the bytes a frame mirror sends
+void countBytes(const uint8_t* data, size_t size, void* ctx)
+{
+	(void)data;
+	*static_cast<size_t*>(ctx) += size;
+}
+
+} // namespace
+
+TEST_CASE("Sequencer resumes after an outside display() restarts its frame",
+		  "[test/animation_sequencer]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	animation_sequencer<> sequencer(d);
+	marching_dot dot;
+
+	d.start();
+	d.uploadChunkSize(8);
+	REQUIRE(sequencer.start(dot));
+
+	emu.manualCompletion(true);
+	sequencer.tick(0);
+	CHECK(sequencer.busy());
+	CHECK(dot.steps == 1);
+
+	// Another part of the application draws and uploads while the frame is in flight
+	d.pixel(40, 40, color::white, mode::normal);
+	d.display();
+	emu.completeAll();
+	CHECK_FALSE(sequencer.busy());
+
+	sequencer.tick(1);
+	emu.completeAll();
+	CHECK(dot.steps == 2);
+	CHECK_FALSE(sequencer.busy());
+	CHECK(emu.pixel(40, 40));
+}
+
+TEST_CASE("Sequencer frames are mirrored", "[test/animation_sequencer]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	animation_sequencer<> sequencer(d);
+	marching_dot dot;
+	size_t mirrored = 0;
+	static_frame_mirror<ssd1306::SCREEN_WIDTH, ssd1306::SCREEN_HEIGHT> mirror(countBytes,
+																			 &mirrored);
+
+	d.start();
+	d.mirror(&mirror);
+	REQUIRE(sequencer.start(dot));
+
+	for(uint32_t now = 0; now < 3; now++)
+	{
+		const auto before = mirrored;
+		sequencer.tick(now);
+		CHECK(mirrored > before);
+	}
+}
+
+TEST_CASE("Sequencer pauses while the display is asleep", "[test/animation_sequencer]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	animation_sequencer<> sequencer(d);
+	marching_dot dot;
+
+	d.start();
+	REQUIRE(sequencer.start(dot));
+	sequencer.tick(0);
+	CHECK(dot.steps == 1);
+
+	d.sleep();
+	emu.resetStats();
+	sequencer.tick(1);
+	CHECK(dot.steps == 1);
+	CHECK(emu.stats().transactions == 0);
+	CHECK_FALSE(sequencer.busy());
+
+	d.wake();
+	sequencer.tick(2);
+	CHECK(dot.steps == 2);
+	CHECK(emu.pixel(1, 5));
+}
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Round-trip test for the frame mirror stream.
+
+Encodes frames with frame_mirror (via mirror_roundtrip_generator), decodes the stream with
+tools/mirror_decode.py, and checks that every decoded frame matches the encoded one. A copy of
+the stream with a corrupted byte checks that the decoder drops the damaged frame and the
+deltas that follow it, and resynchronizes on the next keyframe.
+
+Usage:
+    mirror_roundtrip.py GENERATOR
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+import mirror_decode  # noqa: E402
+
+KEYFRAME_TYPE_OFFSET = len(mirror_decode.SYNC)
+
+
+def generate(generator, directory):
+    """Run the generator and return (stream, frames).
+
+    frames is a list of (offset, seq, buffer) for each emitted frame.
+    """
+    stream_path = os.path.join(directory, 'mirror.bin')
+    expected_path = os.path.join(directory, 'expected.txt')
+    subprocess.run([generator, stream_path, expected_path], check=True)
+
+    with open(stream_path, 'rb') as f:
+        stream = f.read()
+
+    frames = []
+    with open(expected_path) as f:
+        for line in f:
+            offset, seq, data = line.split()
+            frames.append((int(offset), int(seq), bytes.fromhex(data)))
+
+    return stream, frames
+
+
+def is_keyframe(stream, offset):
+    return stream[offset + KEYFRAME_TYPE_OFFSET] == mirror_decode.KEYFRAME
+
+
+def check(decoded, expected, name):
+    if len(decoded) != len(expected):
+        print('{}: decoded {} frames, expected {}'.format(name, len(decoded), len(expected)))
+        return False
+
+    for index, ((seq, _, _, buffer), (_, expected_seq, expected_buffer)) in \
+            enumerate(zip(decoded, expected)):
+        if seq != expected_seq or buffer != expected_buffer:
+            print('{}: frame {} (seq {}) does not match'.format(name, index, expected_seq))
+            return False
+
+    return True
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 2
+
+    with tempfile.TemporaryDirectory() as directory:
+        stream, frames = generate(sys.argv[1], directory)
+
+    ok = check(list(mirror_decode.decode(stream)), frames, 'clean stream')
+
+    # Corrupt a delta frame which is followed by a later keyframe
+    keyframes = [i for i, (offset, _, _) in enumerate(frames) if is_keyframe(stream, offset)]
+    if len(keyframes) < 3:
+        print('the stream has too few keyframes to exercise resynchronization')
+        return 1
+
+    damaged = next(i for i in range(keyframes[1] + 1, len(frames))
+                   if not is_keyframe(stream, frames[i][0]))
+    resync = next(k for k in keyframes if k > damaged)
+
+    # Flip a bit in the last page data byte of the frame, before the end marker and the
+    # checksum. The frame still parses, so only the checksum can reject it.
+    corrupted = bytearray(stream)
+    corrupted[frames[damaged + 1][0] - 4] ^= 0x10
+    expected = frames[:damaged] + frames[resync:]
+    ok = check(list(mirror_decode.decode(bytes(corrupted))), expected, 'corrupted stream') and ok
+
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
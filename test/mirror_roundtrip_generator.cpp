@@ -0,0 +1,135 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+// Writes a frame_mirror stream and the frames it encodes, for test/mirror_roundtrip.py.
+//
+// Usage: mirror_roundtrip_generator STREAM EXPECTED
+//
+// EXPECTED has one line per emitted frame: the offset of the frame in STREAM, its sequence
+// number, and the frame contents in hex. Frames which did not change emit nothing, so they are
+// not listed.
+
+#include "frame_mirror.hpp"
+#include "region.hpp"
+#include <cstdio>
+
+using namespace embdrv;
+
+namespace
+{
+constexpr int FRAMES = 600;
+constexpr uint8_t KEYFRAME_INTERVAL = 16;
+
+struct output
+{
+	FILE* stream;
+	size_t written;
+};
+
+void sink(const uint8_t* data, size_t size, void* ctx)
+{
+	auto* out = static_cast<output*>(ctx);
+	out->written += fwrite(data, 1, size, out->stream);
+}
+
+/// Deterministic pseudo-random numbers, so every run produces the same stream
+uint32_t next(uint32_t& state) noexcept
+{
+	state = state * 1664525U + 1013904223U;
+	return state >> 8U;
+}
+
+int16_t coord(uint32_t& state, int extent) noexcept
+{
+	return static_cast<int16_t>(static_cast<int>(next(state) % static_cast<uint32_t>(extent)));
+}
+
+/// Change the frame in a way that exercises literal packets, repeated runs, and no change
+void change(canvas& frame, uint32_t& state) noexcept
+{
+	const auto w = frame.width();
+	const auto h = frame.height();
+
+	switch(next(state) % 6)
+	{
+		case 0:
+			// Unchanged frame
+			break;
+		case 1:
+			region::fill(frame, coord(state, w), coord(state, h), coord(state, w),
+						 coord(state, h), (next(state) & 1U) != 0);
+			break;
+		case 2:
+			region::scroll(frame, 0, 0, static_cast<int16_t>(w), static_cast<int16_t>(h),
+						   static_cast<int16_t>(coord(state, 9) - 4),
+						   static_cast<int16_t>(coord(state, 9) - 4), false);
+			break;
+		case 3:
+			region::invert(frame, coord(state, w), coord(state, h), coord(state, w),
+						   coord(state, h));
+			break;
+		default:
+			for(int i = 0; i < 8; i++)
+			{
+				auto* b = frame.page(static_cast<uint16_t>(next(state) % frame.pages()),
+									 static_cast<uint16_t>(next(state) % w));
+				*b = static_cast<uint8_t>(*b ^ next(state));
+			}
+			break;
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if(argc != 3)
+	{
+		fprintf(stderr, "usage: %s STREAM EXPECTED\n", argv[0]);
+		return 2;
+	}
+
+	FILE* stream = fopen(argv[1], "wb");
+	FILE* expected = fopen(argv[2], "w");
+	if(!stream || !expected)
+	{
+		fprintf(stderr, "cannot open the output files\n");
+		return 1;
+	}
+
+	output out{stream, 0};
+	static_canvas<64, 48> frame;
+	static_frame_mirror<64, 48> mirror(sink, &out, KEYFRAME_INTERVAL);
+	uint32_t state = 1;
+	uint8_t seq = 0;
+
+	for(int i = 0; i < FRAMES; i++)
+	{
+		change(frame, state);
+
+		if(i == FRAMES / 2)
+		{
+			// A viewer connecting mid-stream
+			mirror.requestKeyframe();
+		}
+
+		const auto offset = out.written;
+		mirror.update(frame);
+		if(out.written == offset)
+		{
+			continue;
+		}
+
+		fprintf(expected, "%zu %u ", offset, seq);
+		for(size_t b = 0; b < frame.size(); b++)
+		{
+			fprintf(expected, "%02x", frame.buffer()[b]);
+		}
+		fprintf(expected, "\n");
+		seq++;
+	}
+
+	fclose(stream);
+	fclose(expected);
+	return 0;
+}
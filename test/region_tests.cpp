@@ -0,0 +1,213 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#include "region.hpp"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <random>
+
+using namespace embdrv;
+
+namespace
+{
+constexpr int ITERATIONS = 2000;
+
+/// Per-pixel reference for the word-at-a-time region operations
+class reference
+{
+  public:
+	explicit reference(const canvas& c) noexcept : c_(c)
+	{
+		memcpy(pixels_, c.buffer(), c.size());
+	}
+
+	uint16_t width() const noexcept
+	{
+		return c_.width();
+	}
+
+	uint16_t height() const noexcept
+	{
+		return c_.height();
+	}
+
+	bool contains(int x, int y) const noexcept
+	{
+		return x >= 0 && y >= 0 && x < c_.width() && y < c_.height();
+	}
+
+	bool get(int x, int y) const noexcept
+	{
+		return (pixels_[index(x, y)] >> (y % canvas::PAGE_HEIGHT)) & 1U;
+	}
+
+	void set(int x, int y, bool on) noexcept
+	{
+		const auto bit = static_cast<uint8_t>(1U << (y % canvas::PAGE_HEIGHT));
+		pixels_[index(x, y)] = static_cast<uint8_t>(on ? (pixels_[index(x, y)] | bit)
+													   : (pixels_[index(x, y)] & ~bit));
+	}
+
+	bool matches(const canvas& c) const noexcept
+	{
+		return memcmp(pixels_, c.buffer(), c.size()) == 0;
+	}
+
+	/// Visit the pixels of a rectangle which are on the canvas
+	template<typename TFn>
+	void forEach(int x, int y, int width, int height, const TFn& fn) const noexcept
+	{
+		for(int row = y; row < y + height; row++)
+		{
+			for(int col = x; col < x + width; col++)
+			{
+				if(contains(col, row))
+				{
+					fn(col, row);
+				}
+			}
+		}
+	}
+
+  private:
+	size_t index(int x, int y) const noexcept
+	{
+		return static_cast<size_t>(y / canvas::PAGE_HEIGHT) * c_.width() + static_cast<size_t>(x);
+	}
+
+	const canvas& c_;
+	uint8_t pixels_[128 * 64 / 8] = {};
+};
+
+bool inside(int px, int py, int x, int y, int width, int height) noexcept
+{
+	return px >= x && py >= y && px < x + width && py < y + height;
+}
+
+void invert(reference& ref, int x, int y, int w, int h)
+{
+	ref.forEach(x, y, w, h, [&](int px, int py) { ref.set(px, py, !ref.get(px, py)); });
+}
+
+void copy(reference& ref, int x, int y, int w, int h, int dst_x, int dst_y)
+{
+	const reference before = ref;
+	before.forEach(x, y, w, h, [&](int px, int py) {
+		const int qx = px + dst_x - x;
+		const int qy = py + dst_y - y;
+		if(ref.contains(qx, qy))
+		{
+			ref.set(qx, qy, before.get(px, py));
+		}
+	});
+}
+
+void move(reference& ref, int x, int y, int w, int h, int dst_x, int dst_y, bool set)
+{
+	copy(ref, x, y, w, h, dst_x, dst_y);
+
+	// Only pixels on the canvas are moved, so the destination covers the clipped source
+	const int left = std::max(x, 0);
+	const int top = std::max(y, 0);
+	const int right = std::min(x + w, static_cast<int>(ref.width()));
+	const int bottom = std::min(y + h, static_cast<int>(ref.height()));
+	const int moved_x = dst_x + left - x;
+	const int moved_y = dst_y + top - y;
+
+	ref.forEach(x, y, w, h, [&](int px, int py) {
+		if(!inside(px, py, moved_x, moved_y, right - left, bottom - top))
+		{
+			ref.set(px, py, set);
+		}
+	});
+}
+
+void scroll(reference& ref, int x, int y, int w, int h, int dx, int dy, bool set)
+{
+	const reference before = ref;
+	before.forEach(x, y, w, h, [&](int px, int py) {
+		const int sx = px - dx;
+		const int sy = py - dy;
+		const bool from_inside = inside(sx, sy, x, y, w, h) && before.contains(sx, sy);
+		ref.set(px, py, from_inside ? before.get(sx, sy) : set);
+	});
+}
+
+/// Run random operations on a canvas and its reference, checking after each one
+void fuzz(canvas& c, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	const int w = c.width();
+	const int h = c.height();
+
+	// Rectangles start up to a quarter of the canvas off each edge, so clipping is exercised
+	const auto coord = [&](int extent) {
+		return std::uniform_int_distribution<int>(-extent / 4, extent + extent / 4)(rng);
+	};
+	const auto size = [&](int extent) {
+		return std::uniform_int_distribution<int>(0, extent + extent / 4)(rng);
+	};
+	const auto offset = [&](int extent) {
+		return std::uniform_int_distribution<int>(-extent, extent)(rng);
+	};
+
+	for(int i = 0; i < ITERATIONS; i++)
+	{
+		for(size_t b = 0; b < c.size(); b++)
+		{
+			c.buffer()[b] = static_cast<uint8_t>(rng());
+		}
+
+		reference ref(c);
+		const auto x = static_cast<int16_t>(coord(w));
+		const auto y = static_cast<int16_t>(coord(h));
+		const auto rw = static_cast<int16_t>(size(w));
+		const auto rh = static_cast<int16_t>(size(h));
+		const auto dx = static_cast<int16_t>(offset(w));
+		const auto dy = static_cast<int16_t>(offset(h));
+		const bool set = (rng() & 1U) != 0;
+		const auto op = rng() % 4;
+
+		CAPTURE(seed, i, op, x, y, rw, rh, dx, dy, set);
+
+		switch(op)
+		{
+			case 0:
+				region::invert(c, x, y, rw, rh);
+				invert(ref, x, y, rw, rh);
+				break;
+			case 1:
+				region::copy(c, x, y, rw, rh, static_cast<int16_t>(x + dx),
+							 static_cast<int16_t>(y + dy));
+				copy(ref, x, y, rw, rh, x + dx, y + dy);
+				break;
+			case 2:
+				region::move(c, x, y, rw, rh, static_cast<int16_t>(x + dx),
+							 static_cast<int16_t>(y + dy), set);
+				move(ref, x, y, rw, rh, x + dx, y + dy, set);
+				break;
+			default:
+				region::scroll(c, x, y, rw, rh, dx, dy, set);
+				scroll(ref, x, y, rw, rh, dx, dy, set);
+				break;
+		}
+
+		REQUIRE(ref.matches(c));
+	}
+}
+
+} // namespace
+
+TEST_CASE("Region operations match a per-pixel reference", "[test/region]")
+{
+	static_canvas<64, 48> screen;
+	fuzz(screen, 1);
+
+	// A width which is not a multiple of the word size leaves a byte-wise tail
+	static_canvas<67, 40> odd;
+	fuzz(odd, 2);
+
+	static_canvas<128, 64> large;
+	fuzz(large, 3);
+}
@@ -0,0 +1,845 @@
+// Copyright 2020 Embedded Artistry LLC
+// SPDX-License-Identifier: MIT
+
+#include "region.hpp"
+#include "ssd1306.hpp"
+#include "ssd1306_emulator.hpp"
+#include "ssd1306_manager.hpp"
+#include "strip_chart.hpp"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <deque>
+
+using namespace embdrv;
+
+namespace
+{
+using color = embvm::basicDisplay::color;
+using mode = embvm::basicDisplay::mode;
+using screen_t = static_canvas<ssd1306::SCREEN_WIDTH, ssd1306::SCREEN_HEIGHT>;
+
+/// Draw the same content into a reference canvas and the display's screen buffer
+template<typename TDraw>
+void drawBoth(ssd1306& display, canvas& reference, const TDraw& draw)
+{
+	display.target(reference);
+	draw();
+	display.targetScreen();
+	draw();
+}
+
+/// @returns true if the glass of the emulated panel shows the expected image
+bool panelShows(const ssd1306_emulator& emu, const canvas& expected)
+{
+	screen_t out;
+	emu.render(out);
+	return memcmp(out.buffer(), expected.buffer(), out.size()) == 0;
+}
+
+/// Copy the part of a canvas that a viewport at (x, y) shows
+void viewportOf(const canvas& source, int16_t x, int16_t y, canvas& out)
+{
+	out.fill(0);
+
+	for(int16_t row = 0; row < ssd1306::SCREEN_HEIGHT; row++)
+	{
+		const auto src_row = static_cast<uint16_t>(row + y);
+
+		for(int16_t col = 0; col < ssd1306::SCREEN_WIDTH; col++)
+		{
+			const auto src_col = static_cast<uint16_t>(col + x);
+			if((*source.page(src_row / 8, src_col) >> (src_row % 8)) & 1U)
+			{
+				*out.page(static_cast<uint16_t>(row / 8), static_cast<uint16_t>(col)) |=
+					static_cast<uint8_t>(1U << (row % 8));
+			}
+		}
+	}
+}
+
+/// Send a transfer to another device on the bus
+void writeOtherDevice(ssd1306_emulator& emu)
+{
+	static const uint8_t payload[2] = {0x01, 0x02};
+
+	embvm::i2c::op_t op;
+	op.address = 0x48;
+	op.tx_buffer = payload;
+	op.tx_size = sizeof(payload);
+	emu.transfer(op);
+}
+
+/// An I2C master which rejects every third transfer without invoking its callback
+class rejecting_master final : public embvm::i2c::master
+{
+  public:
+	unsigned transfers = 0;
+
+  private:
+	void start_() noexcept final {}
+	void stop_() noexcept final {}
+	void configure_(embvm::i2c::pullups pullup) noexcept final
+	{
+		(void)pullup;
+	}
+
+	embvm::i2c::status transfer_(const embvm::i2c::op_t& op,
+								 const embvm::i2c::master::cb_t& cb) noexcept final
+	{
+		if(++transfers % 3 == 0)
+		{
+			return embvm::i2c::status::busy;
+		}
+
+		cb(op, embvm::i2c::status::ok);
+		return embvm::i2c::status::ok;
+	}
+
+	embvm::i2c::baud baudrate_(embvm::i2c::baud baud) noexcept final
+	{
+		return baud;
+	}
+
+	embvm::i2c::pullups setPullups_(embvm::i2c::pullups pullups) noexcept final
+	{
+		return pullups;
+	}
+};
+
+/// An I2C mux with two channels, each with an emulated panel
+class mux_master final : public embvm::i2c::master
+{
+  public:
+	mux_master(ssd1306_emulator& first, ssd1306_emulator& second) noexcept
+		: channels_{&first, &second}
+	{
+	}
+
+	static void select(size_t index, void* ctx) noexcept
+	{
+		static_cast<mux_master*>(ctx)->selected_ = index;
+	}
+
+  private:
+	void start_() noexcept final {}
+	void stop_() noexcept final {}
+	void configure_(embvm::i2c::pullups pullup) noexcept final
+	{
+		(void)pullup;
+	}
+
+	embvm::i2c::status transfer_(const embvm::i2c::op_t& op,
+								 const embvm::i2c::master::cb_t& cb) noexcept final
+	{
+		return channels_[selected_]->transfer(op, cb);
+	}
+
+	embvm::i2c::baud baudrate_(embvm::i2c::baud baud) noexcept final
+	{
+		return baud;
+	}
+
+	embvm::i2c::pullups setPullups_(embvm::i2c::pullups pullups) noexcept final
+	{
+		return pullups;
+	}
+
+	ssd1306_emulator* channels_[2];
+	size_t selected_ = 0;
+};
+
+/// An I2C master which queues transfers and sends them later, to the channel the mux selects at
+/// that time, like a DMA-driven master behind a GPIO-controlled mux
+class queued_mux_master final : public embvm::i2c::master
+{
+  public:
+	queued_mux_master(ssd1306_emulator& first, ssd1306_emulator& second) noexcept
+		: channels_{&first, &second}
+	{
+	}
+
+	static void select(size_t index, void* ctx) noexcept
+	{
+		static_cast<queued_mux_master*>(ctx)->selected_ = index;
+	}
+
+	/// Send the queued transfers, including those queued by their callbacks
+	void completeAll() noexcept
+	{
+		while(!pending_.empty())
+		{
+			const auto t = pending_.front();
+			pending_.pop_front();
+			channels_[selected_]->transfer(t.first, t.second);
+		}
+	}
+
+	size_t pending() const noexcept
+	{
+		return pending_.size();
+	}
+
+  private:
+	void start_() noexcept final {}
+	void stop_() noexcept final {}
+	void configure_(embvm::i2c::pullups pullup) noexcept final
+	{
+		(void)pullup;
+	}
+
+	embvm::i2c::status transfer_(const embvm::i2c::op_t& op,
+								 const embvm::i2c::master::cb_t& cb) noexcept final
+	{
+		pending_.emplace_back(op, cb);
+		return embvm::i2c::status::enqueued;
+	}
+
+	embvm::i2c::baud baudrate_(embvm::i2c::baud baud) noexcept final
+	{
+		return baud;
+	}
+
+	embvm::i2c::pullups setPullups_(embvm::i2c::pullups pullups) noexcept final
+	{
+		return pullups;
+	}
+
+	ssd1306_emulator* channels_[2];
+	size_t selected_ = 0;
+	std::deque<std::pair<embvm::i2c::op_t, embvm::i2c::master::cb_t>> pending_;
+};
+
+/// Forwards transfers to an emulated panel, which completes them before returning, and
+/// records how deeply transfers are nested
+class nesting_master final : public embvm::i2c::master
+{
+  public:
+	explicit nesting_master(ssd1306_emulator& emu) noexcept : emu_(emu) {}
+
+	unsigned max_depth = 0;
+
+  private:
+	void start_() noexcept final {}
+	void stop_() noexcept final {}
+	void configure_(embvm::i2c::pullups pullup) noexcept final
+	{
+		(void)pullup;
+	}
+
+	embvm::i2c::status transfer_(const embvm::i2c::op_t& op,
+								 const embvm::i2c::master::cb_t& cb) noexcept final
+	{
+		depth_++;
+		max_depth = std::max(max_depth, depth_);
+		const auto result = emu_.transfer(op, cb);
+		depth_--;
+		return result;
+	}
+
+	embvm::i2c::baud baudrate_(embvm::i2c::baud baud) noexcept final
+	{
+		return baud;
+	}
+
+	embvm::i2c::pullups setPullups_(embvm::i2c::pullups pullups) noexcept final
+	{
+		return pullups;
+	}
+
+	ssd1306_emulator& emu_;
+	unsigned depth_ = 0;
+};
+
+/// A clock which advances by one millisecond each time it is read
+uint32_t advancingClock()
+{
+	static uint32_t now_ms = 0;
+	return now_ms++;
+}
+
+} // namespace
+
+TEST_CASE("Full frame uploads reach the panel", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	emu.fillGdram(0xA5);
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.start();
+	CHECK(emu.displayOn());
+	CHECK(panelShows(emu, reference));
+
+	drawBoth(d, reference, [&] {
+		d.rectFill(3, 5, 20, 17, color::white, mode::normal);
+		d.line(0, 0, 63, 47, color::white, mode::normal);
+		d.circle(40, 20, 10, color::white, mode::normal);
+	});
+	d.display();
+
+	CHECK(panelShows(emu, reference));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Chunked uploads reach the panel", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.start();
+	d.uploadChunkSize(8);
+
+	drawBoth(d, reference, [&] {
+		d.pixel(60, 40, color::white, mode::normal);
+		d.invertRegion(10, 10, 30, 20);
+	});
+	d.display();
+	CHECK(panelShows(emu, reference));
+
+	drawBoth(d, reference, [&] { d.scrollRegion(0, 0, 64, 48, 3, -5); });
+	d.display();
+	CHECK(panelShows(emu, reference));
+
+	// A second upload while the first is still in flight
+	emu.manualCompletion(true);
+	drawBoth(d, reference, [&] { d.moveRegion(0, 0, 30, 30, 20, 10); });
+	d.display();
+	drawBoth(d, reference, [&] { d.pixel(1, 1, color::white, mode::normal); });
+	d.display();
+	emu.completeAll();
+
+	CHECK_FALSE(d.uploadInProgress());
+	CHECK(panelShows(emu, reference));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Commands issued during a chunked upload are not split", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.start();
+	d.uploadChunkSize(8);
+
+	emu.manualCompletion(true);
+	d.transferWaitHook(
+		[](void* ctx) { return static_cast<ssd1306_emulator*>(ctx)->completeNext(); }, &emu);
+
+	drawBoth(d, reference, [&] { d.rectFill(0, 0, 64, 48, color::white, mode::normal); });
+	d.display();
+
+	// Fill the transfer queue behind the first chunk, so contrast() waits for a slot. The wait
+	// completes the chunk, whose callback queues the next chunk, as an interrupt would.
+	for(int i = 0; i < 14; i++)
+	{
+		d.invert(embvm::basicDisplay::invert::normal);
+	}
+
+	d.contrast(0x10);
+	emu.completeAll();
+
+	CHECK(emu.contrast() == 0x10);
+	CHECK(emu.stats().violations == 0);
+	CHECK(panelShows(emu, reference));
+}
+
+TEST_CASE("Synchronous completions do not nest transfers", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	nesting_master master(emu);
+	ssd1306 d(master);
+	screen_t reference;
+
+	d.start();
+	d.uploadChunkSize(1);
+
+	drawBoth(d, reference, [&] { d.rectFill(0, 0, 64, 48, color::white, mode::normal); });
+	d.display();
+
+	CHECK(master.max_depth == 1);
+	CHECK(panelShows(emu, reference));
+}
+
+TEST_CASE("Viewport uploads show part of a larger canvas", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	static_canvas<128, 64> world;
+	screen_t expected;
+
+	d.start();
+	d.target(world);
+	d.rectFill(0, 0, 128, 64, color::white, mode::normal);
+	d.rectFill(10, 13, 50, 30, color::black, mode::normal);
+	d.targetScreen();
+
+	d.displayViewport(world, 5, 11);
+	viewportOf(world, 5, 11, expected);
+	CHECK(panelShows(emu, expected));
+
+	// The next display() restores the screen buffer
+	d.display();
+	CHECK(panelShows(emu, screen_t{}));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Viewport rows are not split by other bus traffic", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	static_canvas<128, 64> world;
+	screen_t expected;
+
+	d.start();
+	d.target(world);
+	d.circleFill(40, 30, 20, color::white, mode::normal);
+	d.rect(1, 2, 100, 50, color::white, mode::normal);
+	d.targetScreen();
+
+	emu.manualCompletion(true);
+	emu.resetStats();
+	d.displayViewport(world, 7, 13);
+
+	// Another device is addressed between every transfer of the panel
+	while(emu.pending() > 0)
+	{
+		writeOtherDevice(emu);
+		emu.completeNext();
+		emu.completeNext();
+	}
+
+	viewportOf(world, 7, 13, expected);
+	CHECK_FALSE(d.uploadInProgress());
+	CHECK(emu.stats().violations == 0);
+	CHECK(panelShows(emu, expected));
+}
+
+TEST_CASE("Strip charts stream columns to the panel", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t expected;
+
+	d.start();
+
+	strip_chart<1> chart(d, 0, 47, false);
+	chart.begin();
+
+	constexpr int SAMPLES = 70;
+	for(int i = 0; i < SAMPLES; i++)
+	{
+		chart.push({static_cast<int16_t>(i % 48)});
+	}
+
+	// The chart scrolls, so the oldest sample shown is the one pushed SCREEN_WIDTH samples ago
+	for(int col = 0; col < ssd1306::SCREEN_WIDTH; col++)
+	{
+		const int sample = SAMPLES - ssd1306::SCREEN_WIDTH + col;
+		const int row = 47 - (sample % 48);
+		*expected.page(static_cast<uint16_t>(row / 8), static_cast<uint16_t>(col)) |=
+			static_cast<uint8_t>(1U << (row % 8));
+	}
+
+	CHECK(panelShows(emu, expected));
+
+	chart.end();
+	d.display();
+	CHECK(panelShows(emu, screen_t{}));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Strip chart redraws send one transaction per page", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t expected;
+
+	d.start();
+
+	strip_chart<1> chart(d, 0, 47, false);
+	chart.begin();
+
+	for(int i = 0; i < ssd1306::SCREEN_WIDTH; i++)
+	{
+		chart.push({static_cast<int16_t>(i % 48)});
+	}
+
+	// Doubling the range halves the plotted rows
+	emu.resetStats();
+	chart.range(0, 94);
+	CHECK(emu.stats().transactions <= ssd1306::SCREEN_PAGES + 1);
+
+	for(int col = 0; col < ssd1306::SCREEN_WIDTH; col++)
+	{
+		const int row = 47 - ((col % 48) / 2);
+		*expected.page(static_cast<uint16_t>(row / 8), static_cast<uint16_t>(col)) |=
+			static_cast<uint8_t>(1U << (row % 8));
+	}
+
+	CHECK(panelShows(emu, expected));
+
+	// New samples continue from the redrawn chart
+	chart.push({94});
+	region::scroll(expected, 0, 0, ssd1306::SCREEN_WIDTH, ssd1306::SCREEN_HEIGHT, -1, 0,
+				   false);
+	*expected.page(0, ssd1306::SCREEN_WIDTH - 1) = 0x01;
+
+	CHECK(panelShows(emu, expected));
+	CHECK(emu.stats().violations == 0);
+	chart.end();
+}
+
+TEST_CASE("Sleep and wake restore the panel", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.start();
+	drawBoth(d, reference, [&] { d.rectFill(3, 5, 20, 17, color::white, mode::normal); });
+	d.display();
+
+	d.sleep();
+	CHECK_FALSE(emu.displayOn());
+
+	// Only the rows drawn while asleep are sent on wake
+	drawBoth(d, reference, [&] { d.pixel(50, 40, color::white, mode::normal); });
+	d.display();
+	emu.resetStats();
+	d.wake();
+	CHECK(emu.displayOn());
+	CHECK(panelShows(emu, reference));
+	CHECK(emu.stats().bytes < ssd1306::SCREEN_WIDTH);
+
+	// A controller that lost its state is initialized and refreshed
+	d.sleep();
+	emu.reset();
+	emu.fillGdram(0x5A);
+	d.invalidateController();
+	d.wake();
+	CHECK(emu.displayOn());
+	CHECK(panelShows(emu, reference));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Failed transfers are resent", "[test/ssd1306_emulator]")
+{
+	for(const bool governed : {false, true})
+	{
+		for(const uint16_t chunk : {0, 8})
+		{
+			CAPTURE(governed, chunk);
+
+			ssd1306_emulator emu;
+			ssd1306 d(emu);
+			screen_t reference;
+
+			d.start();
+			d.uploadChunkSize(chunk);
+			if(governed)
+			{
+				d.frameRateLimit(10);
+			}
+
+			drawBoth(d, reference,
+					 [&] { d.rectFill(0, 0, 30, 30, color::white, mode::normal); });
+
+			emu.failNext(embvm::i2c::status::dataNACK);
+			d.display();
+			d.tick(1000);
+			CHECK_FALSE(panelShows(emu, reference));
+
+			// The buffer did not change, but the panel is known to be stale
+			d.display();
+			d.tick(2000);
+			d.display();
+			d.tick(3000);
+			CHECK(panelShows(emu, reference));
+		}
+	}
+}
+
+TEST_CASE("The first governed upload after start or wake is not held back",
+		  "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.frameRateLimit(10);
+	d.start();
+	drawBoth(d, reference, [&] { d.rectFill(3, 5, 20, 17, color::white, mode::normal); });
+	d.display();
+	d.tick(0);
+	CHECK(panelShows(emu, reference));
+
+	drawBoth(d, reference, [&] { d.rectFill(30, 5, 20, 17, color::white, mode::normal); });
+	d.display();
+	d.tick(50);
+	CHECK_FALSE(panelShows(emu, reference));
+	d.tick(100);
+	CHECK(panelShows(emu, reference));
+
+	d.sleep();
+	drawBoth(d, reference, [&] { d.rectFill(3, 28, 20, 17, color::white, mode::normal); });
+	d.display();
+	d.wake();
+	d.tick(120);
+	CHECK(panelShows(emu, reference));
+	CHECK(emu.displayOn());
+}
+
+TEST_CASE("Wake after a NACK initializes the controller", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.start();
+	drawBoth(d, reference, [&] { d.rectFill(3, 5, 20, 17, color::white, mode::normal); });
+	d.display();
+
+	emu.failNext(embvm::i2c::status::addrNACK);
+	d.sleep();
+	emu.reset();
+	d.wake();
+
+	CHECK(emu.displayOn());
+	CHECK(panelShows(emu, reference));
+}
+
+TEST_CASE("Restarted uploads complete every frame callback", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	ssd1306_manager<> manager;
+
+	d.start();
+	d.uploadChunkSize(8);
+	manager.add(d);
+
+	emu.manualCompletion(true);
+	d.pixel(1, 1, color::white, mode::normal);
+	d.display();
+	manager.tick(0);
+	CHECK(manager.busy());
+
+	// wake() re-initializes the controller and restarts the frame the manager is waiting for
+	d.sleep();
+	d.invalidateController();
+	d.wake();
+	emu.completeAll();
+
+	CHECK_FALSE(manager.busy());
+}
+
+TEST_CASE("Blocking waits use the transfer wait hook and timeout", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	static_canvas<128, 64> world;
+
+	d.start();
+	emu.manualCompletion(true);
+
+	// Nothing completes transfers, so the second viewport gives up once the timeout expires
+	d.transferWaitTimeout(advancingClock, 50);
+	d.displayViewport(world, 5, 11);
+	d.displayViewport(world, 6, 11);
+	CHECK(d.transferQueueStats().dropped > 0);
+	emu.completeAll();
+
+	d.transferWaitTimeout(nullptr, 0);
+	d.transferWaitHook(
+		[](void* ctx) { return static_cast<ssd1306_emulator*>(ctx)->completeNext(); }, &emu);
+	const auto dropped = d.transferQueueStats().dropped;
+
+	d.target(world);
+	d.rectFill(0, 0, 100, 50, color::white, mode::normal);
+	d.targetScreen();
+	d.displayViewport(world, 5, 11);
+	d.displayViewport(world, 6, 11);
+	emu.completeAll();
+
+	screen_t expected;
+	viewportOf(world, 6, 11, expected);
+	CHECK(d.transferQueueStats().dropped == dropped);
+	CHECK(emu.stats().violations == 0);
+	CHECK(panelShows(emu, expected));
+}
+
+TEST_CASE("Re-initializing the controller keeps the user's settings", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+
+	d.start();
+	d.rectFill(3, 5, 20, 17, color::white, mode::normal);
+	d.contrast(0x10);
+	d.invert(embvm::basicDisplay::invert::invert);
+	d.flipVertical(true);
+	d.flipHorizontal(true);
+	d.display();
+
+	screen_t before;
+	emu.render(before);
+
+	// A single transient NACK invalidates the controller
+	emu.failNext(embvm::i2c::status::dataNACK);
+	d.pixel(40, 40, color::white, mode::normal);
+	d.display();
+	d.pixel(40, 40, color::black, mode::normal);
+	d.sleep();
+	d.wake();
+
+	CHECK(emu.displayOn());
+	CHECK(emu.contrast() == 0x10);
+	CHECK(emu.inverted());
+	CHECK(panelShows(emu, before));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Dropped commands re-initialize the controller", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator emu;
+	ssd1306 d(emu);
+	screen_t reference;
+
+	d.start();
+	drawBoth(d, reference, [&] { d.rectFill(3, 5, 20, 17, color::white, mode::normal); });
+	d.display();
+	d.sleep();
+
+	// Fill the transfer queue, so DISPLAY_ON is dropped once the wait times out
+	emu.manualCompletion(true);
+	d.transferWaitTimeout(advancingClock, 50);
+	for(int i = 0; i < 16; i++)
+	{
+		d.invert(embvm::basicDisplay::invert::normal);
+	}
+
+	const auto dropped = d.transferQueueStats().dropped;
+	d.wake();
+	emu.completeAll();
+	CHECK(d.transferQueueStats().dropped > dropped);
+	CHECK_FALSE(emu.displayOn());
+
+	// The next upload restores the controller and the frame
+	emu.manualCompletion(false);
+	emu.reset();
+	d.display();
+	CHECK(emu.displayOn());
+	CHECK(panelShows(emu, reference));
+	CHECK(emu.stats().violations == 0);
+}
+
+TEST_CASE("Transfers rejected by the master do not stall the driver", "[test/ssd1306_emulator]")
+{
+	rejecting_master master;
+	ssd1306 d(master);
+
+	d.start();
+
+	for(const uint16_t chunk : {0, 8})
+	{
+		d.uploadChunkSize(chunk);
+
+		for(int16_t i = 0; i < 20; i++)
+		{
+			d.pixel(i, i, color::white, mode::normal);
+			d.display();
+		}
+	}
+
+	CHECK_FALSE(d.uploadInProgress());
+}
+
+TEST_CASE("Managed panels behind a mux receive all of their transfers", "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator first;
+	ssd1306_emulator second;
+	mux_master mux(first, second);
+	ssd1306 a(mux);
+	ssd1306 b(mux);
+	ssd1306_manager<> manager;
+
+	manager.add(a, 0, 0, &mux_master::select, &mux);
+	manager.add(b, 0, 0, &mux_master::select, &mux);
+	a.start();
+	b.start();
+	CHECK(first.displayOn());
+	CHECK(second.displayOn());
+
+	first.resetStats();
+	second.resetStats();
+	manager.resetStats(0);
+
+	screen_t first_reference;
+	screen_t second_reference;
+	drawBoth(a, first_reference, [&] { a.pixel(1, 1, color::white, mode::normal); });
+	drawBoth(b, second_reference, [&] { b.pixel(2, 2, color::white, mode::normal); });
+	b.contrast(0x10);
+	a.contrast(0x20);
+
+	for(uint32_t now = 0; now < 10; now++)
+	{
+		manager.tick(now);
+	}
+
+	CHECK(panelShows(first, first_reference));
+	CHECK(panelShows(second, second_reference));
+	CHECK(first.stats().violations == 0);
+	CHECK(second.stats().violations == 0);
+	CHECK(manager.stats(0).frames == 1);
+	CHECK(manager.stats(0).bytes == first.stats().bytes);
+	CHECK(manager.stats(1).bytes == second.stats().bytes);
+}
+
+TEST_CASE("Panels behind a mux wait for the queued transfers of other panels",
+		  "[test/ssd1306_emulator]")
+{
+	ssd1306_emulator first;
+	ssd1306_emulator second;
+	queued_mux_master mux(first, second);
+	ssd1306 a(mux);
+	ssd1306 b(mux);
+	ssd1306_manager<> manager;
+
+	manager.add(a, 0, 0, &queued_mux_master::select, &mux);
+	manager.add(b, 0, 0, &queued_mux_master::select, &mux);
+	a.uploadChunkSize(8);
+	a.start();
+	b.start();
+	mux.completeAll();
+	CHECK(first.displayOn());
+	CHECK(second.displayOn());
+
+	screen_t first_reference;
+	screen_t second_reference;
+	drawBoth(a, first_reference, [&] { a.rectFill(0, 0, 64, 48, color::white, mode::normal); });
+	drawBoth(b, second_reference, [&] { b.pixel(2, 2, color::white, mode::normal); });
+	b.display();
+
+	// b's commands are issued while a's frame is queued on the master
+	manager.tick(0);
+	CHECK(mux.pending() > 0);
+	b.contrast(0x10);
+	b.invert(embvm::basicDisplay::invert::normal);
+	mux.completeAll();
+
+	for(uint32_t now = 1; now < 10; now++)
+	{
+		manager.tick(now);
+		mux.completeAll();
+	}
+
+	CHECK(panelShows(first, first_reference));
+	CHECK(panelShows(second, second_reference));
+	CHECK(second.contrast() == 0x10);
+	CHECK(first.contrast() != 0x10);
+	CHECK(first.stats().violations == 0);
+	CHECK(second.stats().violations == 0);
+}
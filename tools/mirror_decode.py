@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Decode an ssd1306 frame_mirror stream into PBM images.
+
+The stream format is documented in src/ssd1306/frame_mirror.hpp. Frames with a bad checksum,
+or delta frames which do not follow the previously decoded frame, are dropped until the next
+keyframe.
+
+Usage:
+    mirror_decode.py [-o OUTPUT_DIR] [--last] [--invert] [STREAM]
+
+STREAM defaults to stdin, so a serial capture can be piped in directly.
+"""
+
+import argparse
+import os
+import sys
+
+SYNC = b'\xa5\x5a'
+KEYFRAME = ord('K')
+DELTA = ord('D')
+END_OF_FRAME = 0xFF
+PAGE_HEIGHT = 8
+
+
+class DecodeError(Exception):
+    pass
+
+
+def fletcher16(data):
+    sum1 = 0
+    sum2 = 0
+    for b in data:
+        sum1 = (sum1 + b) % 255
+        sum2 = (sum2 + sum1) % 255
+    return sum1, sum2
+
+
+def parse_frame(stream, pos):
+    """Parse the frame starting after the sync bytes at pos.
+
+    Returns (frame, next_pos), where frame is a dict with the type, sequence, dimensions and
+    records of the frame. Raises DecodeError if the frame is malformed or truncated.
+    """
+    start = pos
+
+    def byte():
+        nonlocal pos
+        if pos >= len(stream):
+            raise DecodeError('truncated frame')
+        b = stream[pos]
+        pos += 1
+        return b
+
+    kind = byte()
+    if kind not in (KEYFRAME, DELTA):
+        raise DecodeError('unknown frame type')
+
+    seq = byte()
+    width = byte() + 1
+    pages = byte()
+    records = []
+
+    while True:
+        page = byte()
+        if page == END_OF_FRAME:
+            break
+        if page >= pages:
+            raise DecodeError('page out of range')
+
+        column = byte()
+        count = byte() + 1
+        if column + count > width:
+            raise DecodeError('run out of range')
+
+        data = bytearray()
+        while len(data) < count:
+            packet = byte()
+            n = (packet & 0x7F) + 1
+            if packet & 0x80:
+                data.extend([byte()] * n)
+            else:
+                data.extend(byte() for _ in range(n))
+
+        if len(data) != count:
+            raise DecodeError('run length mismatch')
+
+        records.append((page, column, bytes(data)))
+
+    body = stream[start:pos]
+    checksum = (byte(), byte())
+    if fletcher16(body) != checksum:
+        raise DecodeError('checksum mismatch')
+
+    frame = {'keyframe': kind == KEYFRAME, 'seq': seq, 'width': width, 'pages': pages,
+             'records': records}
+    return frame, pos
+
+
+def decode(stream):
+    """Yield (sequence, width, height, buffer) for each successfully decoded frame."""
+    buffer = None
+    width = pages = 0
+    expected_seq = None
+    pos = 0
+
+    while True:
+        pos = stream.find(SYNC, pos)
+        if pos < 0:
+            return
+
+        try:
+            frame, next_pos = parse_frame(stream, pos + len(SYNC))
+        except DecodeError as e:
+            print('frame at offset {}: {}'.format(pos, e), file=sys.stderr)
+            # Resynchronize on the next sync pattern, and wait for a keyframe
+            pos += 1
+            expected_seq = None
+            continue
+
+        pos = next_pos
+
+        if frame['keyframe']:
+            width = frame['width']
+            pages = frame['pages']
+            buffer = bytearray(width * pages)
+        elif buffer is None or frame['seq'] != expected_seq or \
+                (frame['width'], frame['pages']) != (width, pages):
+            print('dropping delta frame {} until the next keyframe'.format(frame['seq']),
+                  file=sys.stderr)
+            expected_seq = None
+            buffer = None
+            continue
+
+        for page, column, data in frame['records']:
+            offset = page * width + column
+            buffer[offset:offset + len(data)] = data
+
+        expected_seq = (frame['seq'] + 1) % 256
+        yield frame['seq'], width, pages * PAGE_HEIGHT, bytes(buffer)
+
+
+def to_pbm(width, height, buffer, invert):
+    """Convert a page-organized frame into a binary PBM image.
+
+    Lit pixels are white, as on the panel, unless invert is set.
+    """
+    row_bytes = (width + 7) // 8
+    out = bytearray()
+    for y in range(height):
+        row = bytearray(row_bytes)
+        for x in range(width):
+            lit = (buffer[(y // PAGE_HEIGHT) * width + x] >> (y % PAGE_HEIGHT)) & 1
+            # PBM uses 1 for black
+            if lit == invert:
+                row[x // 8] |= 0x80 >> (x % 8)
+        out.extend(row)
+
+    return b'P4\n%d %d\n' % (width, height) + bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode an ssd1306 frame mirror stream')
+    parser.add_argument('stream', nargs='?', help='captured stream (default: stdin)')
+    parser.add_argument('-o', '--output', default='.', help='directory for the PBM files')
+    parser.add_argument('--last', action='store_true', help='only write the last frame')
+    parser.add_argument('--invert', action='store_true', help='draw lit pixels in black')
+    args = parser.parse_args()
+
+    if args.stream:
+        with open(args.stream, 'rb') as f:
+            stream = f.read()
+    else:
+        stream = sys.stdin.buffer.read()
+
+    os.makedirs(args.output, exist_ok=True)
+
+    count = 0
+    last = None
+    for seq, width, height, buffer in decode(stream):
+        count += 1
+        last = (count, width, height, buffer)
+        if not args.last:
+            path = os.path.join(args.output, 'frame_{:05d}.pbm'.format(count))
+            with open(path, 'wb') as f:
+                f.write(to_pbm(width, height, buffer, args.invert))
+
+    if args.last and last:
+        n, width, height, buffer = last
+        with open(os.path.join(args.output, 'frame_last.pbm'), 'wb') as f:
+            f.write(to_pbm(width, height, buffer, args.invert))
+
+    print('decoded {} frames'.format(count), file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())